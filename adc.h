@@ -6,6 +6,7 @@
 #include <chrono>
 #include <array>
 #include <utility>
+#include <tuple> // std::ignore
 #include <cstdint>
 
 namespace ADC
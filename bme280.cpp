@@ -1,7 +1,10 @@
 #include "bme280.h"
 
+#include "byteorder.h"
 #include "timer.h"
 
+#include <array>
+
 namespace
 {
 
@@ -68,21 +71,26 @@ auto BME280::init(Mode mode,
     //if (id != 0x60)
     //    return Status::BAD_ID;
 
-    if (!m_dev.writeReg(Registers::SOFTRESET, 0xB6))
-        return Status::SOFT_RESET_FAILURE;
-
-    for (bool res = true; res;)
     {
-        Timer::wait(std::chrono::milliseconds(10));
-        if (!isReadingCalibration(res))
-            return Status::READING_CALIBRATION_FAILURE;
-    }
+        // Nobody else talks to the bus until the sensor is configured
+        I2C::Device::Lock lock(m_dev);
+
+        if (!m_dev.writeReg(Registers::SOFTRESET, 0xB6))
+            return Status::SOFT_RESET_FAILURE;
 
-    if (!readCoefficients())
-        return Status::READING_COEFFICIENTS_FAILURE;
+        for (bool res = true; res;)
+        {
+            Timer::wait(std::chrono::milliseconds(10));
+            if (!isReadingCalibration(res))
+                return Status::READING_CALIBRATION_FAILURE;
+        }
 
-    if (!setSampling(mode, st, sp, sh, filter, dur))
-        return Status::SETTING_SAMPLING_FAILURE;
+        if (!readCoefficients())
+            return Status::READING_COEFFICIENTS_FAILURE;
+
+        if (!setSampling(mode, st, sp, sh, filter, dur))
+            return Status::SETTING_SAMPLING_FAILURE;
+    }
     Timer::wait(std::chrono::milliseconds(100));
 
     return Status::OK;
@@ -107,36 +115,57 @@ bool BME280::isReadingCalibration(bool& res)
     return true;
 }
 
+// One transaction: 0x88-0x9F, 0xA1 and 0xE1-0xE7 bursts chained with repeated STARTs
 bool BME280::readCoefficients()
 {
-    Calibration calib;
+    LE<uint16_t> t1;
+    LE<int16_t> t2;
+    LE<int16_t> t3;
+    LE<uint16_t> p1;
+    std::array<LE<int16_t>, 8> p; // P2 - P9
+    uint8_t h1 = 0;
+    LE<int16_t> h2;
+    uint8_t h3 = 0;
     uint8_t h4 = 0;
-    uint16_t h5 = 0;
-    bool res =  read(Registers::DIG_T1, calib.digT1)
-             && read(Registers::DIG_T2, calib.digT2)
-             && read(Registers::DIG_T3, calib.digT3)
-
-             && read(Registers::DIG_P1, calib.digP1)
-             && read(Registers::DIG_P2, calib.digP2)
-             && read(Registers::DIG_P3, calib.digP3)
-             && read(Registers::DIG_P4, calib.digP4)
-             && read(Registers::DIG_P5, calib.digP5)
-             && read(Registers::DIG_P6, calib.digP6)
-             && read(Registers::DIG_P7, calib.digP7)
-             && read(Registers::DIG_P8, calib.digP8)
-             && read(Registers::DIG_P9, calib.digP9)
-
-             && read(Registers::DIG_H1, calib.digH1)
-             && read(Registers::DIG_H2, calib.digH2)
-             && read(Registers::DIG_H3, calib.digH3)
-             && read(Registers::DIG_H4, h4)
-             && read(Registers::DIG_H5, h5)
-             && read(Registers::DIG_H6, calib.digH6);
-    if (!res)
+    LE<uint16_t> h5;
+    int8_t h6 = 0;
+    const I2C::Segment segments[] = {
+        {Registers::DIG_T1, &t1, sizeof(t1)},
+        {Registers::DIG_T2, &t2, sizeof(t2)},
+        {Registers::DIG_T3, &t3, sizeof(t3)},
+        {Registers::DIG_P1, &p1, sizeof(p1)},
+        {Registers::DIG_P2, p.data(), sizeof(p)},
+        {Registers::DIG_H1, &h1, sizeof(h1)},
+        {Registers::DIG_H2, &h2, sizeof(h2)},
+        {Registers::DIG_H3, &h3, sizeof(h3)},
+        {Registers::DIG_H4, &h4, sizeof(h4)},
+        {Registers::DIG_H5, &h5, sizeof(h5)},
+        {Registers::DIG_H6, &h6, sizeof(h6)}
+    };
+    if (!m_dev.read(segments))
         return false;
 
-    calib.digH4 = (h4 << 4) + (h5 & 0x000F);
-    calib.digH5 = (h5 >> 4);
+    Calibration calib;
+    calib.digT1 = t1;
+    calib.digT2 = t2;
+    calib.digT3 = t3;
+
+    calib.digP1 = p1;
+    calib.digP2 = p[0];
+    calib.digP3 = p[1];
+    calib.digP4 = p[2];
+    calib.digP5 = p[3];
+    calib.digP6 = p[4];
+    calib.digP7 = p[5];
+    calib.digP8 = p[6];
+    calib.digP9 = p[7];
+
+    calib.digH1 = h1;
+    calib.digH2 = h2;
+    calib.digH3 = h3;
+    calib.digH4 = static_cast<int16_t>((h4 << 4) + (h5 & 0x000F));
+    calib.digH5 = static_cast<int16_t>(h5 >> 4);
+    calib.digH6 = h6;
 
     calib.tFine = 0;
 
@@ -154,7 +183,7 @@ bool BME280::setSampling(Mode mode, Sampling st, Sampling sp, Sampling sh, Filte
 
 bool BME280::readRaw(void* data)
 {
-    return m_dev.readRegs(Registers::PRESSUREDATA, data, 8);
+    return m_dev.read(Registers::PRESSUREDATA, data, 8);
 }
 
 bool BME280::readId(uint8_t& res)
@@ -170,7 +199,7 @@ bool BME280::readStatus(uint8_t& res)
 bool BME280::readData(uint32_t& h, uint32_t& p, int32_t& t)
 {
     uint8_t regs[8];
-    if (!m_dev.readRegs(Registers::PRESSUREDATA, regs, sizeof(regs)))
+    if (!m_dev.read(Registers::PRESSUREDATA, regs, sizeof(regs)))
         return false;
     t = compT(fromThree<int32_t>(regs[3], regs[4], regs[5])); // This should go first
     p = compP(fromThree<uint32_t>(regs[0], regs[1], regs[2]));
@@ -62,6 +62,8 @@ class BME280
         BME280(P& port, uint8_t address)
             : m_dev(port, address)
         {
+            m_dev.setPriority(I2C::Priority::HIGH);
+            m_dev.setRetries(2);
         }
 
         Status init(Mode mode,
@@ -117,12 +119,6 @@ class BME280
         bool readCoefficients();
         bool setSampling(Mode mode, Sampling st, Sampling sp, Sampling sh, Filter filter, Standby dur);
 
-        template <typename T>
-        bool read(uint8_t regNum, T& res)
-        {
-            return m_dev.readRegs(regNum, &res, sizeof(res));
-        }
-
         int32_t compT(int32_t v);
         uint32_t compP(uint32_t v);
         uint32_t compH(uint32_t v);
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "clocks.h"
+#include "i2c.h"
+#include "spi.h"
+#include "displaylink.h"
+#include "keyboard.h"
+#include "panel.h"
+
+#include <type_traits>
+#include <array>
+#include <cstdint>
+
+// Board-level hardware configuration
+namespace Board
+{
+
+using HSE = Clocks::HSE<25.0>;
+using LSE = Clocks::LSE<32.768>;
+using PLL = Clocks::PLL<HSE, 25, 336, 4, 7>;
+using SysClock = Clocks::SysClock<PLL, Clocks::HPRE::DIV2, Clocks::PPRE::DIV2, Clocks::PPRE::DIV1>;
+
+// Larger panels: Panel::SSD1306_128x64 or Panel::SH1106_128x64
+using DisplayPanel = Panel::SSD1306_128x32;
+
+// SSD1306, BME280 and INA219 are all Fm capable
+using I2C1 = I2C::Port<1, SysClock, I2C::Fast<>>;
+using I2C2 = I2C::Port<2, SysClock, I2C::Fast<>>;
+using I2C3 = I2C::Port<3, SysClock, I2C::Fast<>>;
+
+/*
+ * Bus per device. Different ports run their transfers in parallel.
+ * On the 48-pin package I2C2 SDA (PB3) and I2C3 SDA (PB4) are taken by the
+ * keyboard and PB11 is not bonded out, so everything stays on I2C1 here.
+ * A board with a free I2C2/I2C3 pin pair only needs to change these.
+ */
+using DisplayBus = I2C1;
+using SensorBus  = I2C1;
+
+/*
+ * SSD1306 at 0x3C on DisplayBus. The SPI modules take the same panel policy,
+ * a full frame is ~0.2 ms at 21 MHz:
+ *   using DisplayBus  = SPI::Port<1, SysClock>;
+ *   using DisplayLink = SPILink<GPIO::Pin<'B', 0>, GPIO::Pin<'B', 1>, GPIO::Pin<'B', 12>>; // D/C, CS, RES
+ */
+using DisplayLink = I2CLink<0x3C>;
+
+// Bus pins of a port or the GPIO of a link
+template <typename T>
+constexpr bool usesPin(uint16_t code)
+{
+    for (auto pin : T::pins)
+        if (pin == code)
+            return true;
+    return false;
+}
+
+template <typename Port, size_t N>
+constexpr bool avoids(const std::array<uint16_t, N>& pins)
+{
+    for (auto code : pins)
+        if (usesPin<Port>(code))
+            return false;
+    return true;
+}
+
+// I2C and SPI ports of the same number are different peripherals
+template <typename A, typename B>
+constexpr bool disjoint()
+{
+    if constexpr (std::is_same_v<A, B>)
+        return true;
+    else
+    {
+        const auto samePeripheral = I2C::isPort_v<A> == I2C::isPort_v<B> && A::num == B::num;
+        for (auto pin : A::pins)
+            if (usesPin<B>(pin))
+                return false;
+        return !samePeripheral;
+    }
+}
+
+static_assert(avoids<DisplayBus>(Keyboard::pins), "Display bus pins are taken by the keyboard");
+static_assert(avoids<DisplayLink>(Keyboard::pins), "Display link pins are taken by the keyboard");
+static_assert(avoids<SensorBus>(Keyboard::pins), "Sensor I2C pins are taken by the keyboard");
+static_assert(avoids<SensorBus>(DisplayLink::pins), "Sensor I2C pins are taken by the display link");
+static_assert(disjoint<DisplayBus, SensorBus>(), "Display and sensor buses must be different peripherals on different pins");
+static_assert(!(SPI::isPort_v<DisplayBus> && DisplayBus::num == 2 && SensorBus::num == 3), "SPI2 and I2C3 share DMA1 stream 4");
+
+// Owns each selected port once, even if several devices share it
+template <typename D, typename S>
+class Buses
+{
+    public:
+        D& display() { return m_display; }
+        S& sensor() { return m_sensor; }
+        void poll() { m_display.poll(); m_sensor.poll(); }
+
+    private:
+        D m_display;
+        S m_sensor;
+};
+
+template <typename P>
+class Buses<P, P>
+{
+    public:
+        P& display() { return m_port; }
+        P& sensor() { return m_port; }
+        void poll() { m_port.poll(); }
+
+    private:
+        P m_port;
+};
+
+using BusSet = Buses<DisplayBus, SensorBus>;
+
+// The monitor answers on the sensor bus as a target with the readings register map
+constexpr uint8_t TARGET_ADDRESS = 0x42;
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <type_traits>
+#include <cstdint>
+
+/*
+ * Integers as they are laid out in device registers.
+ * Can be used as I2C read buffers directly:
+ *
+ * BE<uint16_t> v;
+ * dev.read(0x02, &v, sizeof(v));
+ * uint16_t value = v;
+ * v = 0x1234; // Encodes back
+ */
+
+template <typename T>
+struct BE
+{
+    static_assert(std::is_integral_v<T>, "Only integer types are supported");
+
+    std::array<uint8_t, sizeof(T)> bytes{};
+
+    constexpr T value() const
+    {
+        std::make_unsigned_t<T> res = 0;
+        for (auto b : bytes)
+            res = static_cast<decltype(res)>((res << 8) | b);
+        return static_cast<T>(res);
+    }
+    constexpr void set(T v)
+    {
+        auto u = static_cast<std::make_unsigned_t<T>>(v);
+        for (auto it = bytes.rbegin(); it != bytes.rend(); ++it, u = static_cast<decltype(u)>(u >> 8))
+            *it = static_cast<uint8_t>(u);
+    }
+    constexpr operator T() const { return value(); }
+    constexpr BE& operator=(T v) { set(v); return *this; }
+};
+
+template <typename T>
+struct LE
+{
+    static_assert(std::is_integral_v<T>, "Only integer types are supported");
+
+    std::array<uint8_t, sizeof(T)> bytes{};
+
+    constexpr T value() const
+    {
+        std::make_unsigned_t<T> res = 0;
+        for (auto it = bytes.rbegin(); it != bytes.rend(); ++it)
+            res = static_cast<decltype(res)>((res << 8) | *it);
+        return static_cast<T>(res);
+    }
+    constexpr void set(T v)
+    {
+        auto u = static_cast<std::make_unsigned_t<T>>(v);
+        for (auto it = bytes.begin(); it != bytes.end(); ++it, u = static_cast<decltype(u)>(u >> 8))
+            *it = static_cast<uint8_t>(u);
+    }
+    constexpr operator T() const { return value(); }
+    constexpr LE& operator=(T v) { set(v); return *this; }
+};
+
+static_assert(sizeof(BE<uint32_t>) == 4 && sizeof(LE<int16_t>) == 2, "No padding is allowed");
@@ -1,160 +1,391 @@
 #include "display.h"
 
-bool Display::init()
+#include "glyph.h"
+#include "systick.h"
+
+#include <algorithm> // std::copy_n, std::min
+
+template <typename P, typename L>
+bool BasicDisplay<P, L>::init()
 {
+    return sendCommands(Panel::init);
+}
 
-    return sendCommand(0xAE) // Turn off
+template <typename P, typename L>
+bool BasicDisplay<P, L>::update()
+{
+    m_frameReady = true;
+    return poll();
+}
+
+template <typename P, typename L>
+bool BasicDisplay<P, L>::poll()
+{
+    if (m_flushing)
+        return true;
+    const auto res = stepFade();
+    if (!m_frameReady || m_scrolling)
+        return res;
+    m_frameReady = false;
+    return flush() && res;
+}
 
-        && sendCommand({0xA8, 0x1F}) // Multiplex ratio (HEIGHT - 1 = 32 - 1 = 0x20 - 1 = 0x1F)
-        && sendCommand({0x20, 0x00}) // Memory mode
-        && sendCommand({0x21, 0x00, 0x7F}) // Width, 0-127
-        && sendCommand({0x22, 0x00, 0x03}) // Height, pages 0-4
+template <typename P, typename L>
+void BasicDisplay<P, L>::waitUpdate()
+{
+    while (m_flushing || (m_frameReady && !m_scrolling))
+    {
+        m_link.poll();
+        poll();
+    }
+}
 
-        && sendCommand(0x40) // Start line
-        && sendCommand({0xD3, 0x00}) // Offset
+template <typename P, typename L>
+void BasicDisplay<P, L>::waitFlush()
+{
+    while (m_flushing)
+        m_link.poll();
+}
 
-        && sendCommand(0xA0) // Remap?
-        && sendCommand(0xC0) // Scan inc?
-        && sendCommand({0xDA, 0x02}) // Pins config?
-        && sendCommand({0x81, 0x8F}) // Contrast
+template <typename P, typename L>
+bool BasicDisplay<P, L>::sleep()
+{
+    waitFlush();
+    m_asleep = true;
+    return sendCommands(Panel::sleep);
+}
 
-        && sendCommand(0xA4) // Resume to RAM
-        && sendCommand(0xA6) // Normal display, 0xA7 - inverted
+// No init and no frame resend, the controller RAM is up to date
+template <typename P, typename L>
+bool BasicDisplay<P, L>::wake()
+{
+    waitFlush();
+    m_asleep = false;
+    return sendCommands(Panel::wake);
+}
 
-        && sendCommand({0xD5, 0x80}) // Display refresh freq
-        && sendCommand({0xD9, 0xF1}) // ?
-        && sendCommand({0xDB, 0x20}) // Voltage level?
+template <typename P, typename L>
+bool BasicDisplay<P, L>::setContrast(uint8_t value)
+{
+    m_fade.active = false;
+    waitFlush();
+    return sendContrast(value);
+}
 
-        //&& sendCommand(0x2E) // Stop scroll
+template <typename P, typename L>
+void BasicDisplay<P, L>::fadeTo(uint8_t value, std::chrono::milliseconds duration)
+{
+    m_fade = {true, m_contrast, value, SysTick::getTick(), static_cast<uint32_t>(duration.count())};
+    if (!m_flushing)
+        stepFade();
+}
 
-        && sendCommand({0x8D, 0x14}) // Chargepump?
+// Linear in time, a step is sent only when the value changes
+template <typename P, typename L>
+bool BasicDisplay<P, L>::stepFade()
+{
+    if (!m_fade.active)
+        return true;
+    const auto elapsed = SysTick::getTick() - m_fade.start;
+    auto value = m_fade.to;
+    if (elapsed < m_fade.duration)
+    {
+        const auto delta = (static_cast<int32_t>(m_fade.to) - m_fade.from) * static_cast<int32_t>(elapsed) / static_cast<int32_t>(m_fade.duration);
+        value = static_cast<uint8_t>(m_fade.from + delta);
+    }
+    else
+        m_fade.active = false;
+    return value == m_contrast || sendContrast(value);
+}
 
-        && sendCommand(0xAF); // Turn on
+template <typename P, typename L>
+bool BasicDisplay<P, L>::sendContrast(uint8_t value)
+{
+    if (!sendCommands(std::array<uint8_t, 2>{0x81, value}))
+        return false;
+    m_contrast = value;
+    return true;
 }
 
-bool Display::update()
+// Parameters can't be changed while scrolling, a running scroll is stopped first
+template <typename P, typename L>
+bool BasicDisplay<P, L>::startScroll(Scroll dir, uint8_t firstPage, uint8_t lastPage, ScrollSpeed speed, uint8_t verticalOffset)
 {
-    for (uint8_t i = 0; i < 4; ++i)
+    if constexpr (!Panel::hasScroll)
+        return false;
+    else
     {
-        if (!sendCommand({0xB0 + i, 0x00, 0x10}))
+        if (m_scrolling && !stopScroll())
             return false;
-        const auto& p = m_pages[i];
-        if (!sendData(p.data(), p.size()))
+        waitUpdate();
+        if (!sendCommands(Panel::scroll(dir, firstPage, lastPage, speed, verticalOffset)) ||
+            !sendCommands(Panel::startScroll))
             return false;
+        m_scrolling = true;
+        return true;
     }
-    return true;
 }
 
-void Display::clear()
+// The RAM was rotated, so nothing of the front buffer is valid.
+// No frame is sent here, the caller is about to draw the next one.
+template <typename P, typename L>
+bool BasicDisplay<P, L>::stopScroll()
 {
-    for (auto& p : m_pages)
-        for (auto& v : p)
-            v = 0;
+    if constexpr (!Panel::hasScroll)
+        return true;
+    else
+    {
+        if (!m_scrolling)
+            return true;
+        waitFlush();
+        m_scrolling = false;
+        m_frontValid = false;
+        return sendCommands(Panel::stopScroll);
+    }
 }
 
-bool Display::printAt(uint8_t x, uint8_t y, const Font& font, const std::string& text, size_t interCharSpace)
+// The bus is idle here, so the front buffer can be swapped safely
+template <typename P, typename L>
+bool BasicDisplay<P, L>::flush()
 {
-    auto pos = x;
-    for (auto c : text)
+    // Only the columns that differ from what the controller has
+    m_frameBytes = 0;
+    for (size_t page = 0; page < m_spans.size(); ++page)
     {
-        if (pos != x)
-        {
-            if (!bar(pos + font.width(), y, interCharSpace, font.height(), Color::Black))
-                return false;
-        }
-        if (!printCharAt(pos, y, font, c))
-            return false;
-        pos += font.width() + interCharSpace;
+        m_spans[page] = changed(page);
+        m_dirty[page] = {};
+        if (!m_spans[page].empty())
+            m_frameBytes += L::busBytes(m_windowCmd.size()) + L::busBytes(m_spans[page].size());
     }
-    return true;
+
+    // Per page windows cost more than the whole frame in one stream
+    if constexpr (Panel::fullFrame)
+    {
+        constexpr auto fullBytes = L::busBytes(Panel::fullWindow.size()) + L::streamBytes(sizeof(Pages));
+        m_fullFrame = m_frameBytes >= fullBytes;
+        if (m_fullFrame)
+            m_frameBytes = fullBytes;
+    }
+
+    m_front = static_cast<uint8_t>(1 - m_front);
+    m_frontValid = true;
+
+    // The buffers differ in the spans only, bring the new back one up to date
+    for (size_t page = 0; page < m_spans.size(); ++page)
+    {
+        const auto& span = m_spans[page];
+        if (!span.empty())
+            std::copy_n(front()[page].begin() + span.first, span.size(), back()[page].begin() + span.first);
+    }
+
+    m_step = 0;
+    m_flushing = true;
+    if (nextUpdateStep())
+        return true;
+    m_flushing = false;
+    m_frontValid = false;
+    return false;
 }
 
-bool Display::printCharAt(uint8_t x, uint8_t y, const Font& font, char c)
+// Dirty span trimmed from both sides to the columns that really changed
+template <typename P, typename L>
+auto BasicDisplay<P, L>::changed(size_t page) const -> Span
 {
-    if (x + font.width() > 127 ||
-        y + font.height() > 31)
-        return false;
-    for (size_t i = 0; i < font.height(); ++i)
+    const auto& b = m_buffers[1 - m_front][page];
+    if (!m_frontValid)
+        return {0, static_cast<uint8_t>(b.size() - 1)};
+    auto span = m_dirty[page];
+    if (span.empty())
+        return span;
+    const auto& f = m_buffers[m_front][page];
+    while (span.first <= span.last && b[span.first] == f[span.first])
+        ++span.first;
+    while (span.last > span.first && b[span.last] == f[span.last])
+        --span.last;
+    return span;
+}
+
+// Even steps set the column/page window, odd steps send the data.
+// Pages without changes are skipped, a full frame is a single window.
+// Each step is submitted from the completion callback of the previous one.
+template <typename P, typename L>
+bool BasicDisplay<P, L>::nextUpdateStep()
+{
+    if constexpr (Panel::fullFrame)
     {
-        const auto line = font.data()[(c - 32) * font.height() + i];
-        auto& p = m_pages[(y + i) / 8];
-        auto offset = (y + i) % 8;
-        for (size_t j = 0; j < font.width(); ++j)
+        if (m_fullFrame)
         {
-            if (((line << j) & 0x8000) == 0x8000)
+            const auto step = m_step++;
+            if (step == 0)
+                return m_link.startCommands(Panel::fullWindow.data(), Panel::fullWindow.size(), onUpdateStep, this);
+            if (step == 1)
             {
-                p[x + j] |= 1 << offset;
-            }
-            else
-            {
-                p[x + j] &= ~(1 << offset);
+                // Split after all, the chunks repeat the address and control byte
+                if (m_link.isContended())
+                    m_frameBytes += L::busBytes(sizeof(Pages)) - L::streamBytes(sizeof(Pages));
+                return m_link.startStream(front()[0].data(), sizeof(Pages), onUpdateStep, this); // Pages are contiguous
             }
+            m_flushing = false;
+            return true;
         }
     }
-    return true;
+
+    auto page = static_cast<uint8_t>(m_step / 2);
+    while (page < m_spans.size() && m_spans[page].empty())
+    {
+        ++page;
+        m_step = static_cast<uint8_t>(page * 2);
+    }
+    if (page == m_spans.size())
+    {
+        m_flushing = false;
+        return true;
+    }
+    const auto& span = m_spans[page];
+    const auto cmd = m_step % 2 == 0;
+    ++m_step;
+    if (cmd)
+    {
+        m_windowCmd = Panel::window(page, span.first, span.last);
+        return m_link.startCommands(m_windowCmd.data(), m_windowCmd.size(), onUpdateStep, this);
+    }
+    return m_link.startData(front()[page].data() + span.first, span.size(), onUpdateStep, this);
 }
 
-bool Display::bar(uint8_t x, uint8_t y, uint8_t w, uint8_t h, Color color)
+template <typename P, typename L>
+void BasicDisplay<P, L>::onUpdateStep(void* context, bool ok)
 {
-    bool res = true;
-    for (uint8_t i = 0; i < h; ++i)
+    auto* d = static_cast<BasicDisplay*>(context);
+    if (!ok || !d->nextUpdateStep())
     {
-        if (y + i > 31)
-            return false;
-        for (uint8_t j = 0; j < w; ++j)
-        {
-            if (x + j > 127)
-            {
-                res = false;
-                break;
-            }
-            auto& p = m_pages[(y + i) / 8];
-            auto offset = (y + i) % 8;
-            if (color == Color::White)
-                p[x + j] |= 1 << offset;
-            else
-                p[x + j] &= ~(1 << offset);
-        }
+        d->m_frontValid = false; // Unknown what the controller has now
+        d->m_flushing = false;
     }
-    return res;
 }
 
-bool Display::hline(uint8_t x, uint8_t y, uint8_t l, Color color)
+// A page-aligned full screen rectangle, memset per page
+template <typename P, typename L>
+void BasicDisplay<P, L>::fill(Color color)
+{
+    bar(0, 0, width, height, color);
+}
+
+// Only the columns that differ from the controller are sent anyway
+template <typename P, typename L>
+void BasicDisplay<P, L>::fill(const Pages& layer)
 {
-    auto& p = m_pages[y / 8];
-    const auto offset = y % 8;
-    for (uint8_t i = 0; i < l; ++i)
+    back() = layer;
+    markDirty({0, 0, width, height});
+}
+
+template <typename P, typename L>
+void BasicDisplay<P, L>::markDirty(const Gfx::Rect& r)
+{
+    if (r.empty())
+        return;
+    const auto last = static_cast<uint8_t>(r.x + r.w - 1);
+    for (auto page = r.y / 8; page <= (r.y + r.h - 1) / 8; ++page)
+        markDirty(static_cast<uint8_t>(page), static_cast<uint8_t>(r.x), last);
+}
+
+template <typename P, typename L>
+bool BasicDisplay<P, L>::printAt(uint8_t x, uint8_t y, const Font& font, std::string_view text, size_t interCharSpace)
+{
+    size_t pos = x;
+    for (auto c : text)
     {
-        if (x + i > 127)
+        if (pos != x)
+        {
+            if (pos + interCharSpace > width)
+                return false;
+            bar(static_cast<int>(pos), y, static_cast<int>(interCharSpace), static_cast<int>(font.height()), Color::Black);
+            pos += interCharSpace;
+        }
+        if (pos > maxX || !printCharAt(static_cast<uint8_t>(pos), y, font, c))
             return false;
-        if (color == Color::White)
-            p[x + i] |= 1 << offset;
-        else
-            p[x + i] &= ~(1 << offset);
+        pos += font.advance(c);
     }
     return true;
 }
 
-bool Display::vline(uint8_t x, uint8_t y, uint8_t l, Color color)
+template <typename P, typename L>
+bool BasicDisplay<P, L>::printCharAt(uint8_t x, uint8_t y, const Font& font, char c)
 {
-    for (uint8_t i = 0; i < l; ++i)
-    {
-        if (y + i > 31)
-            return false;
-        auto& p = m_pages[(y + i) / 8];
-        const auto offset = (y + i) % 8;
-        if (color == Color::White)
-            p[x] |= 1 << offset;
-        else
-            p[x] &= ~(1 << offset);
-    }
+    const auto w = font.advance(c);
+    if (x + w > width ||
+        y + font.height() > height)
+        return false;
+    markDirty({x, y, static_cast<int>(w), static_cast<int>(font.height())});
+    Glyph::blit(back(), x, y, font.glyph(c), w, font.height());
     return true;
 }
 
-bool Display::rect(uint8_t x, uint8_t y, uint8_t l, uint8_t h, Color color)
+template <typename P, typename L>
+bool BasicDisplay<P, L>::printRight(uint8_t x, uint8_t y, const Font& font, std::string_view text, size_t interCharSpace)
+{
+    const auto w = font.textWidth(text, interCharSpace);
+    if (w > x)
+        return false;
+    return printAt(static_cast<uint8_t>(x - w), y, font, text, interCharSpace);
+}
+
+template <typename P, typename L>
+bool BasicDisplay<P, L>::printCenter(uint8_t x, uint8_t y, const Font& font, std::string_view text, size_t interCharSpace)
+{
+    const auto half = font.textWidth(text, interCharSpace) / 2;
+    if (half > x)
+        return false;
+    return printAt(static_cast<uint8_t>(x - half), y, font, text, interCharSpace);
+}
+
+template <typename P, typename L>
+void BasicDisplay<P, L>::bar(int x, int y, int w, int h, Color color, Rop rop)
+{
+    markDirty(Gfx::fillRect(back(), {x, y, w, h}, source(color), rop));
+}
+
+template <typename P, typename L>
+void BasicDisplay<P, L>::hline(int x, int y, int l, Color color, Rop rop)
+{
+    bar(x, y, l, 1, color, rop);
+}
+
+template <typename P, typename L>
+void BasicDisplay<P, L>::vline(int x, int y, int l, Color color, Rop rop)
+{
+    bar(x, y, 1, l, color, rop);
+}
+
+// Sides don't overlap, so Xor outlines have no stray corners
+template <typename P, typename L>
+void BasicDisplay<P, L>::rect(int x, int y, int w, int h, Color color, Rop rop)
+{
+    if (w <= 0 || h <= 0)
+        return;
+    hline(x, y, w, color, rop);
+    if (h > 1)
+        hline(x, y + h - 1, w, color, rop);
+    vline(x, y + 1, h - 2, color, rop);
+    if (w > 1)
+        vline(x + w - 1, y + 1, h - 2, color, rop);
+}
+
+template <typename P, typename L>
+void BasicDisplay<P, L>::line(int x0, int y0, int x1, int y1, Color color, Rop rop)
 {
-    return hline(x, y, l, color) &&
-           hline(x, y + h - 1, l, color) &&
-           vline(x, y, h, color) &&
-           vline(x + l - 1, y, h, color);
+    markDirty(Gfx::line(back(), x0, y0, x1, y1, source(color), rop));
 }
+
+template <typename P, typename L>
+void BasicDisplay<P, L>::circle(int cx, int cy, int r, Color color, Rop rop)
+{
+    markDirty(Gfx::circle(back(), cx, cy, r, source(color), rop));
+}
+
+template <typename P, typename L>
+void BasicDisplay<P, L>::bitmap(int x, int y, const uint8_t* data, int w, int h, Rop rop)
+{
+    markDirty(Gfx::bitmap(back(), x, y, data, w, h, rop));
+}
+
+template class BasicDisplay<Board::DisplayPanel, Board::DisplayLink>;
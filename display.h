@@ -1,61 +1,187 @@
 #pragma once
 
-#include "i2cdev.h"
+#include "displaylink.h"
 #include "fonts.h"
+#include "panel.h"
+#include "board.h"
+#include "gfx.h"
 
-#include <string>
-#include <vector>
+#include <string_view>
 #include <array>
+#include <chrono>
+#include <tuple> // std::tuple_size_v
 #include <cstdint>
 
-class Display
+/*
+ * Template parameters:
+ * P - controller policy from panel.h, Board::DisplayPanel for this board;
+ * L - link to the controller from displaylink.h, Board::DisplayLink.
+ */
+template <typename P, typename L>
+class BasicDisplay
 {
     public:
+        using Panel = P;
+        using FB = typename Panel::FB;
+
         enum class Color
         {
             Black,
             White
         };
+        using Rop = Gfx::Rop;
+        using Scroll = ::Panel::Scroll;
+        using ScrollSpeed = ::Panel::ScrollSpeed;
+
+        using Link = L;
 
-        template <typename P>
-        Display(P& port, uint8_t address)
-            : m_dev(port, address)
+        // The bus port of the link
+        template <typename Port>
+        explicit BasicDisplay(Port& port)
+            : m_link(port)
         {
         }
 
         bool init();
 
-        using Page = std::array<uint8_t, 128>;
-        using Pages = std::array<Page, 32 / 8>;
+        static constexpr size_t width = FB::width;
+        static constexpr size_t height = FB::height;
+        static constexpr uint8_t maxX = width - 1;
+        static constexpr uint8_t maxY = height - 1;
+
+        using Page = typename FB::Page;
+        using Pages = typename FB::Pages;
 
-        Pages& pages() { return m_pages; }
+        // Drawing goes to the back buffer, the front one is what the controller has
+        const Pages& pages() const { return back(); }
 
+        // Frame ready: swaps the buffers and starts the transfer of the changed part in background.
+        // If the previous frame is still being sent, the swap is postponed till poll() or the next update().
         bool update();
+        // Starts the postponed frame once the bus is free
+        bool poll();
+        bool isFrameReady() const { return m_frameReady; }
+        bool isFlushing() const { return m_flushing; }
+        void waitUpdate();
+        // Bus bytes of the last update: window commands and data with the link overhead, see busBytes()
+        size_t frameBytes() const { return m_frameBytes; }
+
+        // The RAM is kept while asleep and updates go on, wake() shows the last frame at once
+        bool sleep();
+        bool wake();
+        bool isAsleep() const { return m_asleep; }
+
+        // Cancels a fade in progress
+        bool setContrast(uint8_t value);
+        uint8_t contrast() const { return m_contrast; }
+        // Ramp from the current contrast, stepped by poll()
+        void fadeTo(uint8_t value, std::chrono::milliseconds duration);
+        bool isFading() const { return m_fade.active; }
 
-        void clear();
+        // The controller scrolls pages [firstPage, lastPage] on its own, no CPU or bus time.
+        // Sends the pending frame first. The RAM must not be written while scrolling,
+        // so frames are held back till stopScroll(). The next update() after it rewrites the whole frame.
+        // False if the panel has no scrolling.
+        bool startScroll(Scroll dir, uint8_t firstPage, uint8_t lastPage, ScrollSpeed speed, uint8_t verticalOffset = 1);
+        bool stopScroll();
+        bool isScrolling() const { return m_scrolling; }
 
-        bool printAt(uint8_t x, uint8_t y, const Font& font, const std::string& text, size_t interCharSpace = 1);
+        void clear() { fill(Color::Black); }
+        void fill(Color color);
+        // Block copy of a static layer, see layer.h
+        void fill(const Pages& layer);
+
+        // Proportional text, false if it doesn't fit
+        bool printAt(uint8_t x, uint8_t y, const Font& font, std::string_view text, size_t interCharSpace = 1);
         bool printCharAt(uint8_t x, uint8_t y, const Font& font, char c);
-        bool bar(uint8_t x, uint8_t y, uint8_t w, uint8_t h, Color color);
-        bool hline(uint8_t x, uint8_t y, uint8_t l, Color color);
-        bool vline(uint8_t x, uint8_t y, uint8_t l, Color color);
-        bool rect(uint8_t x, uint8_t y, uint8_t l, uint8_t h, Color color);
+        // Text ending right before column x, and centered on column x
+        bool printRight(uint8_t x, uint8_t y, const Font& font, std::string_view text, size_t interCharSpace = 1);
+        bool printCenter(uint8_t x, uint8_t y, const Font& font, std::string_view text, size_t interCharSpace = 1);
 
-    private:
-        I2C::Device m_dev;
-        Pages m_pages;
+        // Primitives are clipped to the screen, coordinates may be off it.
+        // The color is the source pixel value the raster op combines with the screen.
+        void bar(int x, int y, int w, int h, Color color, Rop rop = Rop::Copy);
+        void hline(int x, int y, int l, Color color, Rop rop = Rop::Copy);
+        void vline(int x, int y, int l, Color color, Rop rop = Rop::Copy);
+        void rect(int x, int y, int w, int h, Color color, Rop rop = Rop::Copy);
+        void line(int x0, int y0, int x1, int y1, Color color, Rop rop = Rop::Copy);
+        void circle(int cx, int cy, int r, Color color, Rop rop = Rop::Copy);
+        // Page layout, (h + 7) / 8 rows of w bytes
+        void bitmap(int x, int y, const uint8_t* data, int w, int h, Rop rop = Rop::Copy);
+        // Inverse video of an area
+        void invert(int x, int y, int w, int h) { bar(x, y, w, h, Color::White, Rop::Xor); }
 
-        bool sendCommand(const std::vector<uint8_t>& cmds)
+    private:
+        // Column range of a page, empty if first > last
+        struct Span
         {
-            return m_dev.writeRegs(0x00, cmds.data(), cmds.size());
-        }
-        bool sendCommand(uint8_t cmd)
+            uint8_t first = 0xFF;
+            uint8_t last = 0;
+
+            bool empty() const { return first > last; }
+            size_t size() const { return empty() ? 0 : last - first + 1; }
+            void add(uint8_t from, uint8_t to)
+            {
+                if (from < first)
+                    first = from;
+                if (to > last)
+                    last = to;
+            }
+        };
+        using Spans = std::array<Span, std::tuple_size_v<Pages>>;
+
+        struct Fade
         {
-            return m_dev.writeReg(0x00, cmd);
-        }
+            bool active = false;
+            uint8_t from = 0;
+            uint8_t to = 0;
+            uint32_t start = 0;    // SysTick ms
+            uint32_t duration = 0; // ms
+        };
+
+        Link m_link;
+        std::array<Pages, 2> m_buffers;
+        uint8_t m_front = 0;
+        bool m_frontValid = false; // The front buffer matches the controller
+        bool m_frameReady = false;
+        Spans m_dirty;  // Touched by drawing since the last swap
+        Spans m_spans;  // Being sent
+        decltype(Panel::window(0, 0, 0)) m_windowCmd;
+        uint8_t m_step = 0;
+        bool m_fullFrame = false;
+        size_t m_frameBytes = 0;
+        volatile bool m_flushing = false;
+        bool m_asleep = false;
+        bool m_scrolling = false;
+        uint8_t m_contrast = Panel::defaultContrast;
+        Fade m_fade;
 
-        bool sendData(const void* data, size_t size)
+        Pages& front() { return m_buffers[m_front]; }
+        Pages& back() { return m_buffers[1 - m_front]; }
+        const Pages& back() const { return m_buffers[1 - m_front]; }
+
+        bool flush();
+        // Commands share the transaction with the frame transfer
+        void waitFlush();
+        bool stepFade();
+        bool sendContrast(uint8_t value);
+
+        void markDirty(uint8_t page, uint8_t from, uint8_t to) { m_dirty[page].add(from, to); }
+        // The area must be clipped already
+        void markDirty(const Gfx::Rect& r);
+        static constexpr uint8_t source(Color color) { return color == Color::White ? 0xFF : 0x00; }
+        Span changed(size_t page) const;
+
+        // Command sequences live in flash, no copies
+        template <size_t N>
+        bool sendCommands(const std::array<uint8_t, N>& cmds)
         {
-            return m_dev.writeRegs(0x40, data, size);
+            return m_link.commands(cmds.data(), cmds.size());
         }
+
+        bool nextUpdateStep();
+        static void onUpdateStep(void* context, bool ok);
 };
+
+// Implemented in display.cpp for the board panel only
+using Display = BasicDisplay<Board::DisplayPanel, Board::DisplayLink>;
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "i2cdev.h"
+#include "spi.h"
+#include "gpio.h"
+#include "timer.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstddef> // size_t
+
+/*
+ * Links between BasicDisplay and the controller. Both send command and
+ * data bytes, blocking or in background:
+ *
+ * commands(data, size)                    - blocking, for init and settings;
+ * startCommands(data, size, cb, context)  - non-blocking, the callback is called
+ * startData(data, size, cb, context)        from the ISR with the result;
+ * startStream(data, size, cb, context)    - data in one transfer, unless isContended();
+ * isContended()                           - other transfers wait for the bus;
+ * poll()                                  - drives the bus, see the ports;
+ * busBytes(size)                          - bytes on the bus for a transfer of size bytes;
+ * streamBytes(size)                       - the same for an uncontended stream;
+ * pins                                    - GPIO taken besides the bus.
+ *
+ * The data must stay valid until the callback.
+ */
+
+using LinkCallback = void (*)(void* context, bool ok);
+
+// Control byte per transfer: 0x00 - commands, 0x40 - data
+template <uint8_t Address = 0x3C>
+class I2CLink
+{
+    public:
+        static constexpr std::array<uint16_t, 0> pins{};
+        static constexpr size_t chunk = 32;
+
+        // Each chunk is a bus transaction of its own: address and control byte again
+        static constexpr size_t busBytes(size_t size) { return size + (size + chunk - 1) / chunk * 2; }
+        static constexpr size_t streamBytes(size_t size) { return size + 2; }
+
+        template <typename Port>
+        explicit I2CLink(Port& port)
+            : m_dev(port, Address)
+        {
+            // Let sensor reads in between the framebuffer chunks
+            m_dev.setPriority(I2C::Priority::LOW);
+            m_dev.setChunkSize(chunk);
+        }
+
+        bool commands(const uint8_t* data, size_t size) { return m_dev.write(0x00, data, size); }
+        bool startCommands(const uint8_t* data, size_t size, LinkCallback cb, void* context) { return start(0x00, data, size, cb, context); }
+        bool startData(const uint8_t* data, size_t size, LinkCallback cb, void* context) { return start(0x40, data, size, cb, context); }
+        bool isContended() const { return m_dev.isContended(); }
+        void poll() { m_dev.poll(); }
+
+        // Chunks only let the waiting transactions in, with none the stream goes in one
+        bool startStream(const uint8_t* data, size_t size, LinkCallback cb, void* context)
+        {
+            m_dev.setChunkSize(isContended() ? chunk : 0);
+            const auto res = start(0x40, data, size, cb, context);
+            m_dev.setChunkSize(chunk);
+            return res;
+        }
+
+    private:
+        I2C::Device m_dev;
+        LinkCallback m_callback = nullptr;
+        void* m_context = nullptr;
+
+        // The callback of a transfer in flight is kept
+        bool start(uint8_t control, const uint8_t* data, size_t size, LinkCallback cb, void* context)
+        {
+            if (m_dev.isBusy())
+                return false;
+            m_callback = cb;
+            m_context = context;
+            return m_dev.writeRegs(control, data, size, onDone, this);
+        }
+
+        static void onDone(I2C::Transaction& t)
+        {
+            auto* l = static_cast<I2CLink*>(t.context);
+            l->m_callback(l->m_context, t.status == I2C::Status::DONE);
+        }
+};
+
+/*
+ * 4-wire SPI: D/C low for commands, high for data, CS low for the length of
+ * a transfer. The controller is reset through RES on construction.
+ *
+ * Template parameters:
+ * DC, CS, RST - GPIO pins of D/C, CS and RES.
+ */
+template <typename DC, typename CS, typename RST>
+class SPILink
+{
+    public:
+        static_assert(GPIO::isPin_v<DC> && GPIO::isPin_v<CS> && GPIO::isPin_v<RST>, "D/C, CS and RES must be GPIO pins");
+
+        static constexpr std::array<uint16_t, 3> pins = {DC::code, CS::code, RST::code};
+
+        // D/C tells commands from data, nothing is sent besides them
+        static constexpr size_t busBytes(size_t size) { return size; }
+        static constexpr size_t streamBytes(size_t size) { return size; }
+
+        template <typename Port>
+        explicit SPILink(Port& port)
+            : m_port(port)
+        {
+            static_assert(SPI::isPort_v<Port>, "Port must be an SPI port");
+            configure<DC>(false);
+            configure<CS>(true);
+            configure<RST>(false);
+            Timer::wait(std::chrono::milliseconds(1)); // RES low for at least 3 us
+            RST::set(true);
+            Timer::wait(std::chrono::milliseconds(1));
+        }
+
+        bool commands(const uint8_t* data, size_t size)
+        {
+            m_port.wait();
+            select(false);
+            const auto res = m_port.write(data, size);
+            CS::set(true);
+            return res;
+        }
+        bool startCommands(const uint8_t* data, size_t size, LinkCallback cb, void* context) { return start(false, data, size, cb, context); }
+        bool startData(const uint8_t* data, size_t size, LinkCallback cb, void* context) { return start(true, data, size, cb, context); }
+        // Transfers are never split
+        bool startStream(const uint8_t* data, size_t size, LinkCallback cb, void* context) { return startData(data, size, cb, context); }
+        bool isContended() const { return false; }
+        void poll() { m_port.poll(); }
+
+    private:
+        SPI::PortBase& m_port;
+        LinkCallback m_callback = nullptr;
+        void* m_context = nullptr;
+
+        template <typename Pin>
+        static void configure(bool level)
+        {
+            Pin::enable();
+            Pin::set(level);
+            Pin::setMode(GPIO::Mode::OUTPUT);
+            Pin::setOutputType(GPIO::OutputType::PUSH_PULL);
+            Pin::setSpeed(GPIO::Speed::HIGH);
+        }
+
+        // D/C is sampled with the last bit of each byte, it only changes between transfers
+        static void select(bool data)
+        {
+            DC::set(data);
+            CS::set(false);
+        }
+
+        bool start(bool data, const uint8_t* bytes, size_t size, LinkCallback cb, void* context)
+        {
+            if (m_port.isBusy())
+                return false;
+            m_callback = cb;
+            m_context = context;
+            select(data);
+            if (m_port.writeAsync(bytes, size, onDone, this))
+                return true;
+            CS::set(true);
+            return false;
+        }
+
+        static void onDone(void* context, bool ok)
+        {
+            auto* l = static_cast<SPILink*>(context);
+            CS::set(true);
+            l->m_callback(l->m_context, ok);
+        }
+};
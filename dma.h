@@ -0,0 +1,127 @@
+#pragma once
+
+#include "rcc.h"
+#include "utils.h"
+
+#include <cstdint>
+#include <cstddef> // size_t
+
+namespace DMA
+{
+
+struct StreamRegs
+{
+    volatile uint32_t CR;   // Configuration
+    volatile uint32_t NDTR; // Number of data
+    volatile uint32_t PAR;  // Peripheral address
+    volatile uint32_t M0AR; // Memory 0 address
+    volatile uint32_t M1AR; // Memory 1 address
+    volatile uint32_t FCR;  // FIFO control
+};
+
+struct Type
+{
+    volatile uint32_t LISR;  // Low interrupt status (streams 0-3)
+    volatile uint32_t HISR;  // High interrupt status (streams 4-7)
+    volatile uint32_t LIFCR; // Low interrupt flag clear
+    volatile uint32_t HIFCR; // High interrupt flag clear
+    StreamRegs S[8];
+};
+
+inline Type* const DMA1 = reinterpret_cast<Type*>(0x40026000);
+inline Type* const DMA2 = reinterpret_cast<Type*>(0x40026400);
+
+constexpr auto CR_EN    = BIT(0);
+constexpr auto CR_TEIE  = BIT(2);
+constexpr auto CR_TCIE  = BIT(4);
+constexpr auto CR_DIR_M2P = BIT(6);
+constexpr auto CR_MINC  = BIT(10);
+constexpr auto CR_PL_MEDIUM = BIT(16);
+
+constexpr auto FLAG_FE = BIT(0);
+constexpr auto FLAG_DME = BIT(2);
+constexpr auto FLAG_TE = BIT(3);
+constexpr auto FLAG_HT = BIT(4);
+constexpr auto FLAG_TC = BIT(5);
+
+inline
+void enable(const Type* dma)
+{
+    setBit(&RCC::Regs->AHB1ENR, dma == DMA1 ? BIT(21) : BIT(22));
+}
+
+/*
+ * Single byte-wide transfer between a peripheral data register and memory.
+ * Direct mode (no FIFO), no circular mode.
+ */
+class Stream
+{
+    public:
+        constexpr Stream(Type* dma, uint8_t num, uint8_t channel)
+            : m_dma(dma),
+              m_num(num),
+              m_channel(channel)
+        {
+        }
+
+        uint8_t num() const { return m_num; }
+
+        void toPeriph(volatile uint32_t* periph, const void* mem, size_t size, bool tcInterrupt)
+        {
+            start(periph, mem, size, CR_DIR_M2P | (tcInterrupt ? CR_TCIE | CR_TEIE : 0));
+        }
+
+        void fromPeriph(const volatile uint32_t* periph, void* mem, size_t size, bool tcInterrupt)
+        {
+            start(periph, mem, size, tcInterrupt ? CR_TCIE | CR_TEIE : 0);
+        }
+
+        void stop()
+        {
+            clearBit(&regs().CR, CR_EN);
+            waitBitOff(&regs().CR, CR_EN);
+            clearFlags();
+        }
+
+        size_t remaining() const { return m_dma->S[m_num].NDTR; }
+
+        uint32_t flags() const
+        {
+            const auto& isr = m_num < 4 ? m_dma->LISR : m_dma->HISR;
+            return (isr >> offset()) & 0x3D;
+        }
+
+        void clearFlags()
+        {
+            auto& ifcr = m_num < 4 ? m_dma->LIFCR : m_dma->HIFCR;
+            ifcr = 0x3DUL << offset();
+        }
+
+    private:
+        Type* m_dma;
+        uint8_t m_num;
+        uint8_t m_channel;
+
+        StreamRegs& regs() { return m_dma->S[m_num]; }
+
+        // Flag positions within LISR/HISR: 0, 6, 16, 22
+        uint32_t offset() const
+        {
+            const auto n = m_num % 4U;
+            return (n % 2) * 6 + (n / 2) * 16;
+        }
+
+        void start(const volatile uint32_t* periph, const void* mem, size_t size, uint32_t flags)
+        {
+            stop();
+            auto& s = regs();
+            s.PAR = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(periph));
+            s.M0AR = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(mem));
+            s.NDTR = static_cast<uint32_t>(size);
+            s.FCR = 0; // Direct mode
+            s.CR = (static_cast<uint32_t>(m_channel) << 25) | CR_PL_MEDIUM | CR_MINC | flags;
+            setBit(&s.CR, CR_EN);
+        }
+};
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "utils.h"
+
+#include <cstdint>
+
+// Data Watchpoint and Trace unit, used as a free running CPU cycle counter
+namespace DWT
+{
+
+struct Type
+{
+    volatile uint32_t CTRL;   // Control
+    volatile uint32_t CYCCNT; // Cycle count
+};
+
+inline Type* const Regs = reinterpret_cast<Type*>(0xE0001000);
+inline volatile uint32_t* const DEMCR = reinterpret_cast<volatile uint32_t*>(0xE000EDFC);
+
+inline
+void enable()
+{
+    setBit(DEMCR, BIT(24)); // TRCENA
+    Regs->CYCCNT = 0;
+    setBit(&Regs->CTRL, BIT(0)); // CYCCNTENA
+}
+
+inline
+uint32_t cycles()
+{
+    return Regs->CYCCNT;
+}
+
+}
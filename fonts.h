@@ -1,35 +1,132 @@
 #pragma once
 
+#include "fontdata.h"
+#include "glyph.h"
+
+#include <string_view>
 #include <cstdint>
 #include <cstddef>
 
+// Glyph subsets, a font keeps only the glyphs of its charset
+namespace Charset
+{
+
+inline constexpr std::string_view ascii =
+    " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~";
+// Values, date and time, units of the big views
+inline constexpr std::string_view values = " %-.0123456789:Cm";
+// Menu titles
+inline constexpr std::string_view menu = " Sadeimt";
+
+}
+
+/*
+ * Packed tables of a font built at compile time from the glyph rows,
+ * only the template instances in use end up in flash.
+ *
+ * Template parameters:
+ * W, H  - glyph cell size;
+ * Rows  - glyph rows of the whole printable ASCII range from fontdata.h;
+ * Chars - glyphs to keep, the rest are printed blank.
+ */
+template <size_t W, size_t H, const auto& Rows, const std::string_view& Chars>
+struct PackedFont
+{
+    static constexpr size_t streamBytes = Glyph::packedBytes<W, H>(Rows, Chars);
+    static_assert(streamBytes <= 0xFFFF, "Entries keep 16-bit offsets");
+
+    static constexpr auto stream = Glyph::pack<W, H, streamBytes + 4>(Rows, Chars);
+    static constexpr auto glyphs = Glyph::entries<W, H, Chars.size()>(Rows, Chars);
+    static constexpr auto index = Glyph::index<Chars.size()>(Chars);
+
+    static constexpr size_t bytes = sizeof(stream) + sizeof(glyphs) + sizeof(index);
+};
+
+/*
+ * Proportional fonts: a glyph takes its inked columns only, advance(c) wide.
+ * Fonts and their measurements are constexpr, so the width of a literal
+ * string is known at compile time.
+ */
 class Font
 {
     public:
-        static Font font6x8();
-        static Font font7x10();
-        static Font font11x18();
-        static Font font16x26();
+        template <const std::string_view& Chars = Charset::ascii>
+        static constexpr Font font6x8() { return make<PackedFont<6, 8, FontData::font6x8, Chars>>(6, 8); }
+        template <const std::string_view& Chars = Charset::ascii>
+        static constexpr Font font7x10() { return make<PackedFont<7, 10, FontData::font7x10, Chars>>(7, 10); }
+        template <const std::string_view& Chars = Charset::ascii>
+        static constexpr Font font11x18() { return make<PackedFont<11, 18, FontData::font11x18, Chars>>(11, 18); }
+        template <const std::string_view& Chars = Charset::ascii>
+        static constexpr Font font16x26() { return make<PackedFont<16, 26, FontData::font16x26, Chars>>(16, 26); }
+
+        // Cell size, the widest glyph fits into width()
+        constexpr size_t width() const { return m_width; }
+        constexpr size_t height() const { return m_height; }
+        // Flash taken by the packed tables
+        constexpr size_t bytes() const { return m_bytes; }
 
-        size_t width() const { return m_width; }
-        size_t height() const { return m_height; }
-        const uint16_t* data() const { return m_data; }
+        constexpr size_t advance(char c) const { return entry(c).advance; }
+        constexpr bool contains(char c) const { return isPrintable(c) && m_index[Glyph::glyphIndex(c)] != m_missing; }
+        constexpr bool contains(std::string_view text) const
+        {
+            for (auto c : text)
+                if (!contains(c))
+                    return false;
+            return true;
+        }
+        // Inked columns, advance(c) of them, glyphs not in the charset are blank
+        constexpr Glyph::Packed glyph(char c) const
+        {
+            const auto& e = entry(c);
+            return {m_stream + e.offset, m_height, e.blank ? 0 : Glyph::stride(m_height)};
+        }
+
+        // One pass over the text, nothing is rendered
+        constexpr size_t textWidth(std::string_view text, size_t interCharSpace = 1) const
+        {
+            size_t res = 0;
+            for (auto c : text)
+                res += advance(c) + interCharSpace;
+            return text.empty() ? 0 : res - interCharSpace;
+        }
 
     private:
         size_t m_width;
         size_t m_height;
-        const uint16_t* m_data;
+        size_t m_bytes;
+        const uint8_t* m_stream;
+        const Glyph::Entry* m_glyphs;
+        const uint8_t* m_index;
+        uint8_t m_missing;
 
-        Font(size_t w, size_t h, const uint16_t* d)
+        constexpr Font(size_t w, size_t h, size_t bytes, const uint8_t* stream, const Glyph::Entry* glyphs,
+                       const uint8_t* index, uint8_t missing)
                 : m_width(w),
                   m_height(h),
-                  m_data(d)
+                  m_bytes(bytes),
+                  m_stream(stream),
+                  m_glyphs(glyphs),
+                  m_index(index),
+                  m_missing(missing)
         {}
+
+        template <typename Packed>
+        static constexpr Font make(size_t w, size_t h)
+        {
+            return Font(w, h, Packed::bytes, Packed::stream.data(), Packed::glyphs.data(), Packed::index.data(),
+                        static_cast<uint8_t>(Packed::glyphs.size() - 1));
+        }
+
+        static constexpr bool isPrintable(char c) { return c >= ' ' && c <= '~'; }
+        constexpr const Glyph::Entry& entry(char c) const
+        {
+            return m_glyphs[isPrintable(c) ? m_index[Glyph::glyphIndex(c)] : m_missing];
+        }
 };
 
 struct Fonts
 {
-    Font big = Font::font11x18();
-    Font medium = Font::font7x10();
-    Font tiny = Font::font6x8();
+    static constexpr Font big = Font::font11x18<Charset::values>();
+    static constexpr Font medium = Font::font7x10<Charset::menu>();
+    static constexpr Font tiny = Font::font6x8();
 };
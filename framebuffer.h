@@ -0,0 +1,26 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef> // size_t
+
+/*
+ * Monochrome framebuffer in SSD1306/SH1106 memory layout: H / 8 pages of
+ * W bytes, each byte is a column of 8 pixels, LSB on top.
+ */
+template <size_t W, size_t H>
+struct Framebuffer
+{
+    static_assert(H % 8 == 0, "Height must be a whole number of pages");
+    static_assert(W > 0 && W <= 256 && H > 0 && H <= 256, "Coordinates are 8-bit");
+
+    static constexpr size_t width = W;
+    static constexpr size_t height = H;
+    static constexpr size_t pageCount = H / 8;
+
+    using Page = std::array<uint8_t, W>;
+    using Pages = std::array<Page, pageCount>;
+    static_assert(sizeof(Pages) == W * H / 8, "Pages must be contiguous");
+
+    static constexpr bool contains(size_t x, size_t y) { return x < W && y < H; }
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "timer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef> // size_t
+
+/*
+ * Event-driven frame pacing: invalidate() on a change, due() tells when to
+ * draw - once per batch of changes and no more often than maxFps. Frames
+ * and bus bytes are counted over the last full second, poll() rolls it.
+ */
+class FrameRate
+{
+    public:
+        // maxFps = 0 - uncapped, a frame per SysTick at most
+        explicit FrameRate(uint32_t maxFps = 20)
+            : m_interval(std::chrono::milliseconds(maxFps == 0 ? 0 : 1000 / maxFps)),
+              m_second(std::chrono::seconds(1))
+        {
+        }
+
+        // Something on the screen changed
+        void invalidate() { m_pending = true; }
+
+        bool due() const { return m_pending && m_interval.expired(); }
+
+        // Call after the frame is drawn and sent
+        void frame(size_t bytes)
+        {
+            m_pending = false;
+            m_interval.reset();
+            ++m_frames;
+            m_bytes += bytes;
+        }
+
+        // True when a second is over and the counters are new
+        bool poll()
+        {
+            if (!m_second.expired())
+                return false;
+            m_second.reset();
+            m_fps = m_frames;
+            m_bytesPerSecond = m_bytes;
+            m_frames = 0;
+            m_bytes = 0;
+            return true;
+        }
+
+        uint32_t fps() const { return m_fps; }
+        size_t bytesPerSecond() const { return m_bytesPerSecond; }
+
+    private:
+        Timer m_interval;
+        Timer m_second;
+        bool m_pending = true;
+        uint32_t m_frames = 0;
+        size_t m_bytes = 0;
+        uint32_t m_fps = 0;
+        size_t m_bytesPerSecond = 0;
+};
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <array>
+#include <algorithm> // std::min, std::max
+#include <cstring>   // std::memset
+#include <cstdlib>   // std::abs
+#include <cstdint>
+#include <cstddef>   // size_t
+
+/*
+ * Clipped drawing primitives on page-organized 1-bpp memory
+ * (see framebuffer.h). Coordinates may be negative or beyond the screen,
+ * everything outside is clipped. Each function returns the clipped bounding
+ * box of what it touched.
+ *
+ * The source pixels are combined with the destination by a raster op:
+ * Copy - replace, Or - set, And - clear, Xor - invert.
+ */
+
+namespace Gfx
+{
+
+enum class Rop : uint8_t { Copy, Or, And, Xor };
+
+struct Rect
+{
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+
+    bool empty() const { return w <= 0 || h <= 0; }
+};
+
+template <size_t W, size_t P>
+using Pages = std::array<std::array<uint8_t, W>, P>;
+
+template <size_t W, size_t H>
+constexpr Rect clip(const Rect& r)
+{
+    const auto x0 = std::max(r.x, 0);
+    const auto y0 = std::max(r.y, 0);
+    const auto x1 = std::min(r.x + r.w, static_cast<int>(W));
+    const auto y1 = std::min(r.y + r.h, static_cast<int>(H));
+    if (x1 <= x0 || y1 <= y0)
+        return {};
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+// Only the mask bits of dst are affected
+constexpr uint8_t apply(uint8_t dst, uint8_t src, uint8_t mask, Rop rop)
+{
+    switch (rop)
+    {
+        case Rop::Copy: return static_cast<uint8_t>((dst & ~mask) | (src & mask));
+        case Rop::Or:   return static_cast<uint8_t>(dst | (src & mask));
+        case Rop::And:  return static_cast<uint8_t>(dst & (src | ~mask));
+        case Rop::Xor:  return static_cast<uint8_t>(dst ^ (src & mask));
+    };
+    return dst;
+}
+
+// Floor division by 8 for negative coordinates
+constexpr int pageOf(int y)
+{
+    return y >= 0 ? y / 8 : -((7 - y) / 8);
+}
+
+template <size_t W, size_t P>
+constexpr
+void plot(Pages<W, P>& pages, int x, int y, uint8_t src, Rop rop)
+{
+    if (x < 0 || y < 0 || x >= static_cast<int>(W) || y >= static_cast<int>(P * 8))
+        return;
+    auto& b = pages[static_cast<size_t>(y / 8)][static_cast<size_t>(x)];
+    b = apply(b, src, static_cast<uint8_t>(1 << (y % 8)), rop);
+}
+
+// Whole-byte masks per page, fully covered spans are filled with memset where the op allows
+template <size_t W, size_t P>
+inline
+Rect fillRect(Pages<W, P>& pages, const Rect& rect, uint8_t src, Rop rop)
+{
+    const auto r = clip<W, P * 8>(rect);
+    if (r.empty())
+        return r;
+    const auto last = (r.y + r.h - 1) / 8;
+    for (auto page = r.y / 8; page <= last; ++page)
+    {
+        const auto top = std::max(r.y - page * 8, 0);
+        const auto bottom = std::min(r.y + r.h - page * 8, 8);
+        const auto mask = static_cast<uint8_t>((0xFF << top) & (0xFF >> (8 - bottom)));
+        auto* row = pages[static_cast<size_t>(page)].data() + r.x;
+        const auto n = static_cast<size_t>(r.w);
+        if (mask == 0xFF && rop == Rop::Copy)
+            std::memset(row, src, n);
+        else if (mask == 0xFF && rop == Rop::Or && src == 0xFF)
+            std::memset(row, 0xFF, n);
+        else if (mask == 0xFF && rop == Rop::And && src == 0x00)
+            std::memset(row, 0x00, n);
+        else
+            for (size_t i = 0; i < n; ++i)
+                row[i] = apply(row[i], src, mask, rop);
+    }
+    return r;
+}
+
+// Steps a coordinate moving by s takes to get into [0, n)
+constexpr int64_t stepsInto(int v, int s, int n)
+{
+    return s > 0 ? std::max(-v, 0) : std::max(v - (n - 1), 0);
+}
+
+// Bresenham, each pixel is drawn once, so Xor lines are exact.
+// The part before the screen is skipped in one jump and the loop ends where
+// the line leaves it, the pixels are the same as stepping through all of it.
+template <size_t W, size_t P>
+inline
+Rect line(Pages<W, P>& pages, int x0, int y0, int x1, int y1, uint8_t src, Rop rop)
+{
+    constexpr auto width = static_cast<int>(W);
+    constexpr auto height = static_cast<int>(P * 8);
+    const Rect box = {std::min(x0, x1), std::min(y0, y1), std::abs(x1 - x0) + 1, std::abs(y1 - y0) + 1};
+    const auto clipped = clip<W, P * 8>(box);
+    if (clipped.empty())
+        return clipped;
+    const auto dx = std::abs(x1 - x0);
+    const auto dy = -std::abs(y1 - y0);
+    const auto sx = x0 < x1 ? 1 : -1;
+    const auto sy = y0 < y1 ? 1 : -1;
+    auto err = dx + dy;
+
+    // After k steps along the major axis the minor one has taken
+    // (2 * minor * k + major) / (2 * major) steps
+    const bool xMajor = dx >= -dy;
+    const int64_t major = xMajor ? dx : -dy;
+    const int64_t minor = xMajor ? -dy : dx;
+    const auto majorIn = xMajor ? stepsInto(x0, sx, width) : stepsInto(y0, sy, height);
+    const auto minorIn = xMajor ? stepsInto(y0, sy, height) : stepsInto(x0, sx, width);
+    auto k = majorIn;
+    if (minorIn > 0) // minor > 0, the box would be off the screen otherwise
+        k = std::max(k, (2 * major * minorIn - major + 2 * minor - 1) / (2 * minor));
+    if (k > major)
+        return clipped; // Passes by a corner
+    if (k > 0)
+    {
+        const auto m = (2 * minor * k + major) / (2 * major);
+        const auto kx = static_cast<int>(xMajor ? k : m);
+        const auto ky = static_cast<int>(xMajor ? m : k);
+        x0 += sx * kx;
+        y0 += sy * ky;
+        err += dy * kx + dx * ky;
+    }
+
+    while (true)
+    {
+        plot(pages, x0, y0, src, rop);
+        if (x0 == x1 && y0 == y1)
+            break;
+        const auto e2 = 2 * err;
+        if (e2 >= dy)
+        {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            y0 += sy;
+        }
+        // Both coordinates are monotonic, nothing comes back onto the screen
+        if ((sx > 0 ? x0 >= width : x0 < 0) || (sy > 0 ? y0 >= height : y0 < 0))
+            break;
+    }
+    return clipped;
+}
+
+// Midpoint circle outline, symmetric points are drawn once
+template <size_t W, size_t P>
+inline
+Rect circle(Pages<W, P>& pages, int cx, int cy, int radius, uint8_t src, Rop rop)
+{
+    if (radius < 0)
+        return {};
+    auto plot4 = [&](int a, int b)
+    {
+        plot(pages, cx + a, cy + b, src, rop);
+        if (a != 0)
+            plot(pages, cx - a, cy + b, src, rop);
+        if (b != 0)
+            plot(pages, cx + a, cy - b, src, rop);
+        if (a != 0 && b != 0)
+            plot(pages, cx - a, cy - b, src, rop);
+    };
+    auto x = radius;
+    auto y = 0;
+    auto err = 1 - radius;
+    while (x >= y)
+    {
+        plot4(x, y);
+        if (x != y)
+            plot4(y, x);
+        ++y;
+        if (err < 0)
+            err += 2 * y + 1;
+        else
+        {
+            --x;
+            err += 2 * (y - x) + 1;
+        }
+    }
+    return clip<W, P * 8>({cx - radius, cy - radius, 2 * radius + 1, 2 * radius + 1});
+}
+
+/*
+ * 1-bpp bitmap in the same page layout: (h + 7) / 8 rows of w bytes,
+ * LSB on top. Each source byte lands in at most two destination pages.
+ */
+template <size_t W, size_t P>
+inline
+Rect bitmap(Pages<W, P>& pages, int x, int y, const uint8_t* data, int w, int h, Rop rop)
+{
+    const auto box = clip<W, P * 8>({x, y, w, h});
+    if (box.empty())
+        return box;
+    const auto shift = y - pageOf(y) * 8;
+    const auto rows = (h + 7) / 8;
+    for (auto r = 0; r < rows; ++r)
+    {
+        const auto valid = std::min(h - r * 8, 8);
+        const auto rowMask = static_cast<uint16_t>(((1 << valid) - 1) << shift);
+        const auto page = pageOf(y) + r;
+        for (auto i = std::max(0, -x); i < w && x + i < static_cast<int>(W); ++i)
+        {
+            const auto bits = static_cast<uint16_t>(data[r * w + i] << shift);
+            const auto dx = static_cast<size_t>(x + i);
+            if (page >= 0 && page < static_cast<int>(P))
+            {
+                auto& b = pages[static_cast<size_t>(page)][dx];
+                b = apply(b, static_cast<uint8_t>(bits), static_cast<uint8_t>(rowMask), rop);
+            }
+            if (page + 1 >= 0 && page + 1 < static_cast<int>(P) && (rowMask >> 8) != 0)
+            {
+                auto& b = pages[static_cast<size_t>(page + 1)][dx];
+                b = apply(b, static_cast<uint8_t>(bits >> 8), static_cast<uint8_t>(rowMask >> 8), rop);
+            }
+        }
+    }
+    return box;
+}
+
+}
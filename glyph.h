@@ -0,0 +1,264 @@
+#pragma once
+
+#include <array>
+#include <algorithm> // std::min
+#include <string_view>
+#include <cstring> // std::memcpy
+#include <cstdint>
+#include <cstddef> // size_t
+
+/*
+ * Glyphs in SSD1306 memory layout.
+ *
+ * Font tables are stored row by row, one uint16_t per row, MSB is the leftmost
+ * pixel. The display memory is organized in 8-pixel high pages, one byte per
+ * column, LSB is the top pixel. toColumns() turns the rows into one uint32_t
+ * per column (bit 0 is the top row) at compile time, so blit() only shifts a
+ * column to the target y and merges it into each page it touches.
+ *
+ * Neither is kept in flash: pack() stores only the inked columns of the glyphs
+ * of a charset, one after another, each in the fewest whole bytes H bits fit
+ * (LSB first). Blank glyphs take no bytes. Reader gets a column back with
+ * a single load and no shifts.
+ */
+
+namespace Glyph
+{
+
+// N rows of H-pixel high, W-pixel wide glyphs into columns
+template <size_t W, size_t H, size_t N>
+constexpr std::array<uint32_t, N / H * W> toColumns(const std::array<uint16_t, N>& rows)
+{
+    static_assert(W <= 16, "Rows are 16 bits wide");
+    static_assert(H <= 32, "Columns are 32 bits high");
+    static_assert(N % H == 0, "Incomplete glyph");
+
+    std::array<uint32_t, N / H * W> res{};
+    for (size_t g = 0; g < N / H; ++g)
+        for (size_t row = 0; row < H; ++row)
+            for (size_t col = 0; col < W; ++col)
+                if ((rows[g * H + row] << col) & 0x8000)
+                    res[g * W + col] |= 1U << row;
+    return res;
+}
+
+// Inked columns of a glyph: the first one and how many, blank glyphs are half a cell wide
+struct Metrics
+{
+    uint8_t offset = 0;
+    uint8_t advance = 0;
+    bool blank = false;
+};
+
+template <size_t W, size_t H, size_t N>
+constexpr std::array<Metrics, N / H> metrics(const std::array<uint16_t, N>& rows)
+{
+    std::array<Metrics, N / H> res{};
+    for (size_t g = 0; g < N / H; ++g)
+    {
+        uint16_t ink = 0;
+        for (size_t row = 0; row < H; ++row)
+            ink |= rows[g * H + row];
+        size_t first = W;
+        size_t last = 0;
+        for (size_t col = 0; col < W; ++col)
+        {
+            if (((ink << col) & 0x8000) == 0)
+                continue;
+            first = std::min(first, col);
+            last = col;
+        }
+        if (first == W)
+            res[g] = {0, static_cast<uint8_t>(W / 2), true};
+        else
+            res[g] = {static_cast<uint8_t>(first), static_cast<uint8_t>(last - first + 1)};
+    }
+    return res;
+}
+
+// A glyph of a packed font
+struct Entry
+{
+    uint16_t offset = 0; // First byte in the stream, blank glyphs point to the zero padding
+    uint8_t advance = 0;
+    bool blank = false;
+};
+
+// Printable ASCII, glyph numbers are from ' '
+constexpr size_t GLYPHS = 95;
+
+constexpr size_t glyphIndex(char c)
+{
+    return static_cast<size_t>(c - ' ');
+}
+
+// Bits per column in the stream
+constexpr size_t stride(size_t h)
+{
+    return (h + 7) / 8 * 8;
+}
+
+template <size_t H>
+constexpr size_t glyphBytes(const Metrics& m)
+{
+    return m.blank ? 0 : (m.advance * stride(H) + 7) / 8;
+}
+
+template <size_t W, size_t H, size_t N>
+constexpr size_t packedBytes(const std::array<uint16_t, N>& rows, std::string_view charset)
+{
+    const auto m = metrics<W, H>(rows);
+    size_t res = 0;
+    for (auto c : charset)
+        res += glyphBytes<H>(m[glyphIndex(c)]);
+    return res;
+}
+
+// Padded by 4 bytes for the loads of Packed
+template <size_t W, size_t H, size_t Bytes, size_t N>
+constexpr std::array<uint8_t, Bytes> pack(const std::array<uint16_t, N>& rows, std::string_view charset)
+{
+    const auto cols = toColumns<W, H>(rows);
+    const auto m = metrics<W, H>(rows);
+    std::array<uint8_t, Bytes> res{};
+    size_t offset = 0;
+    for (auto c : charset)
+    {
+        const auto g = glyphIndex(c);
+        for (size_t i = 0, bit = offset * 8; i < m[g].advance && !m[g].blank; ++i, bit += stride(H))
+            for (size_t row = 0; row < H; ++row)
+                if ((cols[g * W + m[g].offset + i] >> row) & 1)
+                    res[(bit + row) / 8] |= static_cast<uint8_t>(1 << ((bit + row) % 8));
+        offset += glyphBytes<H>(m[g]);
+    }
+    return res;
+}
+
+// One per charset glyph and the trailing blank one for the rest
+template <size_t W, size_t H, size_t C, size_t N>
+constexpr std::array<Entry, C + 1> entries(const std::array<uint16_t, N>& rows, std::string_view charset)
+{
+    const auto m = metrics<W, H>(rows);
+    const auto padding = static_cast<uint16_t>(packedBytes<W, H>(rows, charset));
+    std::array<Entry, C + 1> res{};
+    size_t offset = 0;
+    for (size_t i = 0; i < C; ++i)
+    {
+        const auto& g = m[glyphIndex(charset[i])];
+        res[i] = {g.blank ? padding : static_cast<uint16_t>(offset), g.advance, g.blank};
+        offset += glyphBytes<H>(g);
+    }
+    res[C] = {padding, static_cast<uint8_t>(W / 2), true};
+    return res;
+}
+
+// Glyph number to entry number, C - the blank entry for the glyphs not in the charset
+template <size_t C>
+constexpr std::array<uint8_t, GLYPHS> index(std::string_view charset)
+{
+    static_assert(C < 0xFF, "Too many glyphs");
+    std::array<uint8_t, GLYPHS> res{};
+    res.fill(static_cast<uint8_t>(C));
+    for (size_t i = 0; i < C; ++i)
+        res[glyphIndex(charset[i])] = static_cast<uint8_t>(i);
+    return res;
+}
+
+// A glyph in a packed stream: columns of h bits from the first bit of
+// `columns` on, `step` bits apart. Blank glyphs point to the zero padding with step 0.
+struct Packed
+{
+    const uint8_t* columns;
+    size_t h;
+    size_t step;
+};
+
+// Column reader for Bytes-byte columns, always byte aligned. 3-byte ones are
+// read with a word load, the stream padding keeps it inside.
+template <size_t Bytes>
+class Reader
+{
+    public:
+        explicit Reader(const Packed& g)
+            : m_column(g.columns)
+        {
+        }
+
+        uint32_t next()
+        {
+            uint32_t v = 0;
+            std::memcpy(&v, m_column, Bytes == 3 ? 4 : Bytes); // Little endian, unaligned loads on Cortex-M4
+            m_column += Bytes;
+            if constexpr (Bytes == 3)
+                v &= 0x00FFFFFF;
+            return v; // Zero padded past the glyph height
+        }
+
+    private:
+        const uint8_t* m_column;
+};
+
+inline uint32_t next(const uint32_t*& columns) { return *columns++; }
+template <size_t Bytes>
+inline uint32_t next(Reader<Bytes>& columns) { return columns.next(); }
+
+// Merges w columns of h pixels into the pages at (x, y), pixels outside of
+// the glyph are kept intact. Columns is a uint32_t pointer or a Reader.
+// Each page is merged in a single pass, the columns are read and shifted
+// to y during the first one.
+template <size_t PageCount, size_t Width, typename Columns>
+inline
+void merge(std::array<std::array<uint8_t, Width>, PageCount>& pages,
+           size_t x, size_t y, Columns columns, size_t w, size_t h)
+{
+    std::array<uint64_t, 16> cols; // Glyphs are at most 16 columns wide, see toColumns()
+    const auto shift = y % 8;
+    const auto first = y / 8;
+    const auto last = (y + h - 1) / 8;
+    const auto mask = ((uint64_t{1} << h) - 1) << shift;
+
+    auto m = static_cast<uint8_t>(mask);
+    auto* row = pages[first].data() + x;
+    for (size_t i = 0; i < w; ++i)
+    {
+        cols[i] = uint64_t{next(columns)} << shift;
+        row[i] = static_cast<uint8_t>((row[i] & ~m) | (static_cast<uint8_t>(cols[i]) & m));
+    }
+    for (size_t page = first + 1, offset = 8; page <= last; ++page, offset += 8)
+    {
+        m = static_cast<uint8_t>(mask >> offset);
+        row = pages[page].data() + x;
+        for (size_t i = 0; i < w; ++i)
+            row[i] = static_cast<uint8_t>((row[i] & ~m) | (static_cast<uint8_t>(cols[i] >> offset) & m));
+    }
+}
+
+// Copies a w x h glyph to (x, y), the caller checks the bounds
+template <size_t PageCount, size_t Width>
+inline
+void blit(std::array<std::array<uint8_t, Width>, PageCount>& pages,
+          size_t x, size_t y, const uint32_t* columns, size_t w, size_t h)
+{
+    merge(pages, x, y, columns, w, h);
+}
+
+// The reader is picked once per glyph, not per column, blank glyphs aren't read
+template <size_t PageCount, size_t Width>
+inline
+void blit(std::array<std::array<uint8_t, Width>, PageCount>& pages,
+          size_t x, size_t y, const Packed& glyph, size_t w, size_t h)
+{
+    static constexpr std::array<uint32_t, 16> blank{};
+    if (glyph.step == 0)
+        merge(pages, x, y, blank.data(), w, h);
+    else if (h <= 8)
+        merge(pages, x, y, Reader<1>(glyph), w, h);
+    else if (h <= 16)
+        merge(pages, x, y, Reader<2>(glyph), w, h);
+    else if (h <= 24)
+        merge(pages, x, y, Reader<3>(glyph), w, h);
+    else
+        merge(pages, x, y, Reader<4>(glyph), w, h);
+}
+
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "gfx.h"
+
+#include <array>
+#include <algorithm> // std::copy, std::min, std::max
+#include <cstdlib>   // std::abs
+#include <cstdint>
+#include <cstddef>   // size_t
+
+/*
+ * Minimum and maximum of the last N values, O(1) amortized per value.
+ * Two monotonic deques of sample numbers: the front of each is the extreme
+ * of the window, a new value drops the ones it dominates from the back.
+ */
+template <typename T, size_t N>
+class SlidingMinMax
+{
+    public:
+        void push(T v)
+        {
+            const auto seq = m_seq++;
+            m_values[seq % N] = v;
+            m_min.push(seq, m_values, [](T back, T x) { return back >= x; });
+            m_max.push(seq, m_values, [](T back, T x) { return back <= x; });
+        }
+
+        bool empty() const { return m_seq == 0; }
+        size_t size() const { return std::min<size_t>(m_seq, N); }
+        // Most recent first: at(0) is the last pushed value
+        T at(size_t age) const { return m_values[(m_seq - 1 - age) % N]; }
+        T min() const { return m_values[m_min.front() % N]; }
+        T max() const { return m_values[m_max.front() % N]; }
+
+    private:
+        // Ring of sample numbers, never holds more than N
+        class Deque
+        {
+            public:
+                template <typename Dominated>
+                void push(uint32_t seq, const std::array<T, N>& values, Dominated dominated)
+                {
+                    // Out of the window, at most one per push
+                    if (m_size > 0 && seq - front() >= N)
+                    {
+                        m_head = (m_head + 1) % N;
+                        --m_size;
+                    }
+                    while (m_size > 0 && dominated(values[back() % N], values[seq % N]))
+                        --m_size;
+                    m_seq[(m_head + m_size++) % N] = seq;
+                }
+
+                uint32_t front() const { return m_seq[m_head]; }
+
+            private:
+                std::array<uint32_t, N> m_seq{};
+                size_t m_head = 0;
+                size_t m_size = 0;
+
+                uint32_t back() const { return m_seq[(m_head + m_size - 1) % N]; }
+        };
+
+        std::array<T, N> m_values{};
+        Deque m_min;
+        Deque m_max;
+        uint32_t m_seq = 0;
+};
+
+/*
+ * Sparkline of the last W samples in a W x H bitmap, auto-scaled to the
+ * sliding min/max. The newest sample is the rightmost column. While the
+ * scale stays the same a new sample shifts the bitmap one column left and
+ * draws the new column only, otherwise all columns are redrawn.
+ *
+ * Template parameters:
+ * W - width, one column per sample;
+ * H - height in pixels.
+ */
+template <size_t W, size_t H>
+class Graph
+{
+    public:
+        static constexpr size_t width = W;
+        static constexpr size_t height = H;
+
+        void push(int32_t v)
+        {
+            const auto full = m_samples.size() == W;
+            const auto min = m_samples.min();
+            const auto max = m_samples.max();
+            m_samples.push(v);
+            ++m_version;
+            if (full && min == m_samples.min() && max == m_samples.max())
+                shift();
+            else
+                redraw();
+        }
+
+        void clear() { *this = {}; }
+
+        bool empty() const { return m_samples.empty(); }
+        // Changes with every sample
+        uint32_t version() const { return m_version; }
+        int32_t min() const { return m_samples.min(); }
+        int32_t max() const { return m_samples.max(); }
+
+        // Page layout, the format Display::bitmap() takes
+        const uint8_t* data() const { return m_pixels.front().data(); }
+
+        // Copies the whole rectangle, the background included, in one pass
+        template <typename D>
+        void draw(D& display, int x, int y) const
+        {
+            display.bitmap(x, y, data(), W, H);
+        }
+
+    private:
+        using Pixels = Gfx::Pages<W, (H + 7) / 8>;
+
+        SlidingMinMax<int32_t, W> m_samples;
+        Pixels m_pixels{};
+        uint32_t m_version = 0;
+
+        // Top is the maximum, a flat line sits in the middle
+        int y(size_t age) const
+        {
+            const auto range = static_cast<int64_t>(max()) - min();
+            if (range == 0)
+                return static_cast<int>(H / 2);
+            const auto v = static_cast<int64_t>(m_samples.at(age)) - min();
+            return static_cast<int>(static_cast<int64_t>(H - 1) - v * static_cast<int64_t>(H - 1) / range);
+        }
+
+        // Vertical segment from the previous sample to this one, so steep changes stay connected
+        void drawColumn(size_t age)
+        {
+            const auto x = static_cast<int>(W - 1 - age);
+            const auto y1 = y(age);
+            const auto y0 = age + 1 < m_samples.size() ? y(age + 1) : y1;
+            Gfx::fillRect(m_pixels, {x, std::min(y0, y1), 1, std::abs(y1 - y0) + 1}, 0xFF, Gfx::Rop::Copy);
+        }
+
+        void shift()
+        {
+            for (auto& page : m_pixels)
+            {
+                std::copy(page.begin() + 1, page.end(), page.begin());
+                page.back() = 0;
+            }
+            drawColumn(0);
+        }
+
+        void redraw()
+        {
+            m_pixels = {};
+            for (size_t age = 0; age < m_samples.size(); ++age)
+                drawColumn(age);
+        }
+};
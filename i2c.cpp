@@ -1,6 +1,872 @@
 #include "i2c.h"
+#include "i2cerror.h"
+
+#include "nvic.h"
+#include "dma.h"
+#include "dwt.h"
+#include "systick.h"
+
+#include <algorithm> // std::min
 
 using PortBase = I2C::PortBase;
+using Transaction = I2C::Transaction;
+using Status = I2C::Status;
+using SchedulerStats = I2C::SchedulerStats;
+using BusStats = I2C::BusStats;
+using DeviceStats = I2C::DeviceStats;
+using CriticalSection = NVIC::CriticalSection;
+using ErrorAction = I2C::ErrorAction;
+using I2C::SR1_BERR;
+using I2C::SR1_ARLO;
+using I2C::SR1_AF;
+using I2C::SR1_OVR;
+
+namespace
+{
+
+constexpr auto CR1_PE    = BIT(0);
+constexpr auto CR1_START = BIT(8);
+constexpr auto CR1_STOP  = BIT(9);
+constexpr auto CR1_ACK   = BIT(10);
+constexpr auto CR1_POS   = BIT(11);
+
+constexpr auto CR2_ITERREN = BIT(8);
+constexpr auto CR2_ITEVTEN = BIT(9);
+constexpr auto CR2_ITBUFEN = BIT(10);
+constexpr auto CR2_DMAEN   = BIT(11);
+constexpr auto CR2_LAST    = BIT(12);
+
+constexpr auto SR1_SB   = BIT(0);
+constexpr auto SR1_ADDR = BIT(1);
+constexpr auto SR1_BTF  = BIT(2);
+constexpr auto SR1_STOPF = BIT(4);
+constexpr auto SR1_RXNE = BIT(6);
+constexpr auto SR1_TXE  = BIT(7);
+
+constexpr auto SR1_ERRORS = SR1_BERR | SR1_ARLO | SR1_AF | SR1_OVR;
+
+constexpr auto SR2_TRA = BIT(2);
+
+// Utilization window, SysTick ms
+constexpr uint32_t STATS_WINDOW = 1000;
+
+// STOP takes one SCL period, this is way more than that at any bus speed
+constexpr uint32_t STOP_SPIN = 10000;
+
+// DMA1 request mapping, RM0368 table 27
+struct DMAStreams
+{
+    DMA::Stream rx;
+    DMA::Stream tx;
+    NVIC::IRQ rxIRQ;
+};
+
+DMAStreams dmaStreams[3] = {
+    {{DMA::DMA1, 0, 1}, {DMA::DMA1, 6, 1}, NVIC::IRQ::DMA1_Stream0}, // I2C1
+    {{DMA::DMA1, 3, 7}, {DMA::DMA1, 7, 7}, NVIC::IRQ::DMA1_Stream3}, // I2C2
+    {{DMA::DMA1, 2, 3}, {DMA::DMA1, 4, 3}, NVIC::IRQ::DMA1_Stream2}  // I2C3
+};
+
+}
+
+namespace I2C
+{
+
+// Interrupt-driven master state machine, one instance per peripheral.
+class Engine
+{
+    public:
+        void attach(PortBase* port, Regs* regs, DMAStreams* dma)
+        {
+            m_port = port;
+            m_regs = regs;
+            m_dmaStreams = dma;
+            // Reinitialized in the middle of a target transfer
+            if (m_targetActive)
+            {
+                m_targetActive = false;
+                m_target.onStop(m_target.context);
+            }
+        }
+
+        bool submit(Transaction& t);
+        bool isIdle() const { return m_current == nullptr; }
+        bool hasQueued() const { return m_queue != nullptr; }
+
+        SchedulerStats stats() const;
+        void resetStats();
+        BusStats busStats() const;
+        void resetBusStats();
+
+        void setDMAThreshold(size_t v) { m_dmaThreshold = v < 2 ? 2 : v; }
+
+        bool tryLock(const void* owner);
+        void unlock(const void* owner);
+
+        void setTarget(const TargetHandlers& handlers) { m_target = handlers; }
+        bool hasTarget() const { return m_target.onRead != nullptr; }
+
+        void onEvent();
+        void onError();
+        void onDMA();
+        void poll();
+
+    private:
+        enum class Phase : uint8_t { START, REG, RESTART, TX, RX };
+
+        PortBase* m_port = nullptr;
+        Regs* m_regs = nullptr;
+        DMAStreams* m_dmaStreams = nullptr;
+        uint32_t m_speed = 100000;
+        uint32_t m_deadline = 0;
+        Transaction* volatile m_current = nullptr;
+        Transaction* m_queue = nullptr; // Sorted by priority, FIFO within the same priority
+        const void* m_owner = nullptr;
+        TargetHandlers m_target;
+        bool m_addressSent = false; // ADDR after our own START belongs to the master side
+        bool m_targetActive = false;
+        bool m_targetTx = false;
+        Phase m_phase = Phase::START;
+        size_t m_index = 0;
+        size_t m_burst = 0;
+        size_t m_seg = 0;       // Read segment being filled
+        size_t m_segOffset = 0;
+        size_t m_groupEnd = 0;  // Past the last segment of the current burst
+        size_t m_groupSize = 0; // Bytes in the current burst
+        size_t m_dmaThreshold = 8;
+        bool m_dma = false;
+        SchedulerStats m_stats;
+        BusStats m_busStats;
+        DeviceStats* m_devStats = nullptr; // Of the current transaction
+        volatile bool m_broken = false;    // Nothing starts till poll() recovers the bus
+        uint32_t m_startedAt = 0;
+        uint32_t m_windowStart = 0;       // SysTick
+        uint32_t m_windowStartCycles = 0;
+        uint64_t m_windowBusy = 0;
+
+        void enqueue(Transaction& t);
+        DeviceStats& deviceStats(uint8_t address);
+        void updateUtilization();
+        void arm(size_t bytes);
+        bool waitStop();
+        void fail(Status s);
+        void halt();
+        void startNext();
+        void beginGroup(const Transaction& t);
+        void stopOrRestart();
+        void endGroup();
+        void endBurst();
+        void release();
+        void clearAddr();
+        void startRead(const Transaction& t);
+        void onTx(Transaction& t, uint32_t sr1);
+        void onRx(Transaction& t, uint32_t sr1);
+        void readByte(Transaction& t);
+        void complete(Status s);
+        bool isTarget(uint32_t sr1) const;
+        void onTarget(uint32_t sr1);
+        void endTarget();
+        void requestStart();
+};
+
+}
+
+using Engine = I2C::Engine;
+
+namespace
+{
+
+Engine engines[3];
+
+}
+
+bool Engine::submit(Transaction& t)
+{
+    if (t.isRead())
+    {
+        if (t.segmentCount == 0 || t.chunk != 0)
+            return false; // Reads can't be split
+        for (size_t i = 0; i < t.segmentCount; ++i)
+            if (t.segments[i].size == 0)
+                return false;
+    }
+
+    CriticalSection cs;
+    if (t.isPending())
+        return false;
+
+    t.status = Status::PENDING;
+    t.offset = 0;
+    t.attempt = 0;
+    t.queuedAt = DWT::cycles();
+    enqueue(t);
+    if (m_current == nullptr)
+        startNext();
+    return true;
+}
+
+SchedulerStats Engine::stats() const
+{
+    CriticalSection cs;
+    return m_stats;
+}
+
+void Engine::resetStats()
+{
+    CriticalSection cs;
+    m_stats.maxDepth = m_stats.depth;
+    m_stats.maxWait = {};
+}
+
+BusStats Engine::busStats() const
+{
+    CriticalSection cs;
+    return m_busStats;
+}
+
+void Engine::resetBusStats()
+{
+    CriticalSection cs;
+    const auto utilization = m_busStats.utilization;
+    m_busStats = {};
+    m_busStats.utilization = utilization;
+    if (m_current != nullptr)
+        m_devStats = &deviceStats(m_current->address);
+}
+
+// Linear search, there are only a few devices on a bus
+DeviceStats& Engine::deviceStats(uint8_t address)
+{
+    auto& bs = m_busStats;
+    for (size_t i = 0; i < bs.devices; ++i)
+        if (bs.perDevice[i].address == address)
+            return bs.perDevice[i];
+    if (bs.devices == bs.perDevice.size())
+        return bs.untracked;
+    auto& res = bs.perDevice[bs.devices++];
+    res.address = address;
+    return res;
+}
+
+void Engine::updateUtilization()
+{
+    const auto now = SysTick::getTick();
+    if (now - m_windowStart < STATS_WINDOW)
+        return;
+    const auto cycles = DWT::cycles();
+    const auto total = cycles - m_windowStartCycles;
+    if (total != 0)
+        m_busStats.utilization = static_cast<uint8_t>(std::min<uint64_t>(m_windowBusy * 100 / total, 100));
+    m_windowStart = now;
+    m_windowStartCycles = cycles;
+    m_windowBusy = 0;
+}
+
+// Must be called with the engine interrupts masked
+void Engine::enqueue(Transaction& t)
+{
+    auto** pos = &m_queue;
+    while (*pos != nullptr && std::to_underlying((*pos)->priority) >= std::to_underlying(t.priority))
+        pos = &(*pos)->next;
+    t.next = *pos;
+    *pos = &t;
+
+    ++m_stats.depth;
+    if (m_stats.depth > m_stats.maxDepth)
+        m_stats.maxDepth = m_stats.depth;
+}
+
+bool Engine::tryLock(const void* owner)
+{
+    CriticalSection cs;
+    if (m_owner != nullptr && m_owner != owner)
+        return false;
+    m_owner = owner;
+    return true;
+}
+
+void Engine::unlock(const void* owner)
+{
+    CriticalSection cs;
+    if (m_owner != owner)
+        return;
+    m_owner = nullptr;
+    // Transactions of others may be waiting
+    if (m_current == nullptr)
+        startNext();
+}
+
+void Engine::startNext()
+{
+    // The first one by priority, skipping the others while the bus is locked
+    auto** pos = &m_queue;
+    while (*pos != nullptr && m_owner != nullptr && (*pos)->owner != m_owner)
+        pos = &(*pos)->next;
+    auto* t = *pos;
+    if (t == nullptr || m_broken)
+        return;
+    // STOP from the previous transaction may still be in progress
+    if (!waitStop())
+    {
+        ++deviceStats(t->address).recoveries;
+        halt();
+        return;
+    }
+    *pos = t->next;
+    t->next = nullptr;
+    --m_stats.depth;
+
+    if (t->offset == 0)
+    {
+        // Time to the first byte, later chunks don't count
+        const auto wait = DWT::cycles() - t->queuedAt;
+        auto& maxWait = m_stats.maxWait[std::to_underlying(t->priority)];
+        if (wait > maxWait)
+            maxWait = wait;
+    }
+
+    if (t->isRead())
+    {
+        m_seg = 0;
+        m_segOffset = 0;
+        beginGroup(*t);
+    }
+    else
+    {
+        const auto left = t->size - t->offset;
+        m_burst = t->chunk != 0 && t->chunk < left ? t->chunk : left;
+        m_dma = m_dmaStreams != nullptr && m_burst >= m_dmaThreshold;
+    }
+    m_phase = Phase::START;
+    m_index = 0;
+    m_current = t;
+
+    m_devStats = &deviceStats(t->address);
+    m_speed = m_port->setSpeed(t->speed);
+    m_startedAt = DWT::cycles();
+
+    arm(2); // START and address
+    setBit(&m_regs->CR2, CR2_ITEVTEN | CR2_ITERREN);
+    requestStart();
+}
+
+// Segments with adjacent registers are read in one burst, the register pointer
+// of the device advances by itself
+void Engine::beginGroup(const Transaction& t)
+{
+    m_groupEnd = m_seg;
+    m_groupSize = 0;
+    do
+    {
+        m_groupSize += t.segments[m_groupEnd].size;
+        ++m_groupEnd;
+    } while (m_groupEnd < t.segmentCount && t.autoIncrement &&
+             t.segments[m_groupEnd].regNum == t.segments[m_groupEnd - 1].regNum + t.segments[m_groupEnd - 1].size);
+    // DMA can't scatter
+    m_dma = m_dmaStreams != nullptr && m_groupEnd - m_seg == 1 && m_groupSize >= m_dmaThreshold;
+}
+
+// Requested before the last byte of a burst is received
+void Engine::stopOrRestart()
+{
+    if (m_groupEnd < m_current->segmentCount)
+        requestStart(); // Chain the next burst, the bus is kept
+    else
+        setBit(&m_regs->CR1, CR1_STOP);
+}
+
+// The last byte of a burst is received
+void Engine::endGroup()
+{
+    auto* t = m_current;
+    m_devStats->bytesRx += static_cast<uint32_t>(m_groupSize);
+    if (m_seg == t->segmentCount)
+    {
+        complete(Status::DONE);
+        return;
+    }
+    // Repeated START is on the way, reset the receiver for the next burst
+    clearBit(&m_regs->CR2, CR2_ITBUFEN | CR2_DMAEN | CR2_LAST);
+    clearBit(&m_regs->CR1, CR1_POS);
+    if (m_dma)
+        m_dmaStreams->rx.stop();
+    beginGroup(*t);
+    m_phase = Phase::START;
+    arm(2);
+}
+
+// Phase deadline: 9 SCL periods per byte, twice that for clock stretching,
+// plus one tick for the SysTick granularity. Unless the transaction has its own.
+void Engine::arm(size_t bytes)
+{
+    if (m_current->timeout != 0)
+    {
+        m_deadline = SysTick::getTick() + m_current->timeout;
+        return;
+    }
+    const auto ms = (bytes * 9 * 2 * 1000 + m_speed - 1) / m_speed;
+    m_deadline = SysTick::getTick() + static_cast<uint32_t>(ms) + 1;
+}
+
+bool Engine::waitStop()
+{
+    for (uint32_t i = 0; i < STOP_SPIN; ++i)
+        if (!isBitSet(&m_regs->CR1, CR1_STOP))
+            return true;
+    return false;
+}
+
+// The recovery clocks SCL by hand for up to ~100 us, so it runs here
+// with the interrupts on, never in an ISR or a critical section
+void Engine::poll()
+{
+    {
+        CriticalSection cs;
+        updateUtilization();
+        if (m_current != nullptr && static_cast<int32_t>(SysTick::getTick() - m_deadline) > 0)
+            fail(Status::TIMEOUT);
+    }
+    if (!m_broken)
+        return;
+    m_port->recover();
+    CriticalSection cs;
+    m_broken = false;
+    if (m_current == nullptr)
+        startNext();
+}
+
+// Something is wrong with the bus, drop the transaction and leave the bus to poll()
+void Engine::fail(Status s)
+{
+    ++m_devStats->recoveries;
+    halt();
+    complete(s);
+}
+
+// The peripheral stays off and quiet till the recovery
+void Engine::halt()
+{
+    m_broken = true;
+    clearBit(&m_regs->CR2, CR2_ITEVTEN | CR2_ITERREN | CR2_ITBUFEN);
+    clearBit(&m_regs->CR1, CR1_PE);
+}
+
+void Engine::requestStart()
+{
+    m_addressSent = false;
+    setBit(&m_regs->CR1, CR1_START);
+}
+
+void Engine::onEvent()
+{
+    const auto sr1 = m_regs->SR1;
+    if (isTarget(sr1))
+    {
+        onTarget(sr1);
+        return;
+    }
+
+    auto* t = m_current;
+    if (t == nullptr)
+        return;
+
+    // SB of a chained burst may come together with the last byte of the previous one
+    if (m_phase == Phase::RX)
+    {
+        onRx(*t, sr1);
+        return;
+    }
+
+    if ((sr1 & SR1_SB) != 0)
+    {
+        if (m_phase == Phase::RESTART)
+            m_regs->DR = (t->address << 1) + 1;
+        else
+            m_regs->DR = t->address << 1;
+        m_addressSent = true;
+        return;
+    }
+
+    if ((sr1 & SR1_ADDR) != 0)
+    {
+        if (m_phase == Phase::RESTART)
+            return startRead(*t);
+        clearAddr();
+        ++m_devStats->bytesTx;
+        if (t->isRead())
+        {
+            m_regs->DR = t->segments[m_seg].regNum;
+            m_phase = Phase::REG; // Wait BTF before the repeated START
+            arm(1);
+            return;
+        }
+        m_regs->DR = t->regNum;
+        m_phase = Phase::TX;
+        arm(1 + m_burst);
+        if (m_dma)
+        {
+            // DMA request comes on TxE, after the register number is moved to the shift register
+            m_dmaStreams->tx.toPeriph(&m_regs->DR, t->tx + t->offset, m_burst, false);
+            setBit(&m_regs->CR2, CR2_DMAEN);
+        }
+        else
+            setBit(&m_regs->CR2, CR2_ITBUFEN);
+        return;
+    }
+
+    switch (m_phase)
+    {
+        case Phase::REG:
+            if ((sr1 & SR1_BTF) != 0)
+            {
+                m_phase = Phase::RESTART;
+                arm(2);
+                requestStart();
+            }
+            break;
+        case Phase::TX: onTx(*t, sr1); break;
+        case Phase::RX:
+        case Phase::START:
+        case Phase::RESTART:
+            break;
+    };
+}
+
+void Engine::onError()
+{
+    const auto sr1 = m_regs->SR1;
+    clearBit(&m_regs->SR1, SR1_ERRORS);
+
+    if (m_targetActive)
+    {
+        // The controller NACKs the last byte it reads, anything else aborts the target transfer as well
+        endTarget();
+        if ((sr1 & SR1_AF) != 0)
+            return;
+    }
+
+    if (m_current == nullptr)
+        return;
+
+    switch (I2C::errorAction(sr1))
+    {
+        // NACK is a normal slave response, the bus is fine
+        case ErrorAction::NACK:
+            setBit(&m_regs->CR1, CR1_STOP);
+            complete(Status::NACK);
+            break;
+        // The other controller owns the bus now, clocking SCL would corrupt its transfer.
+        // The transaction goes again against its retries once the bus is free.
+        case ErrorAction::RETRY:
+            complete(Status::ERROR);
+            break;
+        case ErrorAction::RECOVER:
+            fail(Status::ERROR);
+            break;
+    };
+}
+
+void Engine::onDMA()
+{
+    const auto flags = m_dmaStreams->rx.flags();
+    m_dmaStreams->rx.clearFlags();
+
+    if (m_current == nullptr || m_phase != Phase::RX)
+        return;
+
+    if ((flags & DMA::FLAG_TE) != 0)
+    {
+        fail(Status::ERROR);
+        return;
+    }
+    if ((flags & DMA::FLAG_TC) != 0)
+    {
+        // The last byte was NACKed because of LAST
+        stopOrRestart();
+        m_seg = m_groupEnd;
+        endGroup();
+    }
+}
+
+void Engine::clearAddr()
+{
+    // Clear ADDR by reading SR1 and SR2
+    volatile uint32_t temp = 0;
+    temp = m_regs->SR1;
+    temp = m_regs->SR2;
+    (void) temp;
+}
+
+void Engine::startRead(const Transaction& t)
+{
+    // RM0368, 18.3.3: the last byte must be NACKed, so ACK/POS/STOP have to be
+    // arranged before ADDR is cleared for 1 and 2 byte receptions.
+    m_phase = Phase::RX;
+    m_index = 0;
+    arm(m_groupSize);
+    if (m_dma)
+    {
+        // LAST makes the peripheral NACK the byte of the DMA end of transfer
+        m_dmaStreams->rx.fromPeriph(&m_regs->DR, t.segments[m_seg].buf, m_groupSize, true);
+        setBit(&m_regs->CR1, CR1_ACK);
+        setBit(&m_regs->CR2, CR2_DMAEN | CR2_LAST);
+        clearAddr();
+        return;
+    }
+    if (m_groupSize == 1)
+    {
+        clearBit(&m_regs->CR1, CR1_ACK);
+        clearAddr();
+        stopOrRestart();
+        setBit(&m_regs->CR2, CR2_ITBUFEN);
+    }
+    else if (m_groupSize == 2)
+    {
+        clearBit(&m_regs->CR1, CR1_ACK);
+        setBit(&m_regs->CR1, CR1_POS);
+        clearAddr(); // Wait BTF
+    }
+    else
+    {
+        setBit(&m_regs->CR1, CR1_ACK);
+        clearAddr();
+        if (m_groupSize > 3)
+            setBit(&m_regs->CR2, CR2_ITBUFEN); // Wait BTF otherwise
+    }
+}
+
+void Engine::onTx(Transaction& t, uint32_t sr1)
+{
+    if (m_dma)
+    {
+        if ((sr1 & SR1_BTF) != 0 && m_dmaStreams->tx.remaining() == 0)
+            endBurst();
+        return;
+    }
+    if (m_index == m_burst)
+    {
+        if ((sr1 & SR1_BTF) != 0)
+            endBurst();
+        else
+            clearBit(&m_regs->CR2, CR2_ITBUFEN); // Last byte is in the shift register, wait BTF
+        return;
+    }
+    if ((sr1 & SR1_TXE) != 0)
+        m_regs->DR = t.tx[t.offset + m_index++];
+}
+
+void Engine::onRx(Transaction& t, uint32_t sr1)
+{
+    if (m_dma)
+        return; // Completion comes from the DMA interrupt
+    const auto remaining = m_groupSize - m_index;
+    if (remaining > 3)
+    {
+        if ((sr1 & SR1_RXNE) == 0)
+            return;
+        readByte(t);
+        if (m_groupSize - m_index == 3)
+            clearBit(&m_regs->CR2, CR2_ITBUFEN); // Switch to BTF for the last 3 bytes
+        return;
+    }
+    if (remaining == 3)
+    {
+        if ((sr1 & SR1_BTF) == 0)
+            return;
+        // N-2 in DR, N-1 in the shift register, NACK the last one
+        clearBit(&m_regs->CR1, CR1_ACK);
+        readByte(t);
+        return;
+    }
+    if (remaining == 2)
+    {
+        if ((sr1 & SR1_BTF) == 0)
+            return;
+        stopOrRestart();
+        readByte(t);
+        readByte(t);
+        endGroup();
+        return;
+    }
+    // Single byte reception, STOP or START was already requested
+    if ((sr1 & SR1_RXNE) == 0)
+        return;
+    readByte(t);
+    endGroup();
+}
+
+void Engine::readByte(Transaction& t)
+{
+    const auto& seg = t.segments[m_seg];
+    static_cast<uint8_t*>(seg.buf)[m_segOffset] = static_cast<uint8_t>(m_regs->DR);
+    ++m_index;
+    if (++m_segOffset == seg.size)
+    {
+        ++m_seg;
+        m_segOffset = 0;
+    }
+}
+
+// Write burst is over, let higher priority transactions in before the next chunk
+void Engine::endBurst()
+{
+    auto* t = m_current;
+    setBit(&m_regs->CR1, CR1_STOP);
+    m_devStats->bytesTx += static_cast<uint32_t>(m_burst);
+    t->offset += m_burst;
+    if (t->offset < t->size)
+    {
+        release();
+        enqueue(*t);
+        startNext();
+        return;
+    }
+    complete(Status::DONE);
+}
+
+void Engine::release()
+{
+    clearBit(&m_regs->CR2, CR2_ITBUFEN | CR2_DMAEN | CR2_LAST);
+    clearBit(&m_regs->CR1, CR1_POS);
+    if (hasTarget())
+        setBit(&m_regs->CR1, CR1_ACK); // Keep answering as a target
+    else
+        clearBit(&m_regs->CR2, CR2_ITEVTEN | CR2_ITERREN);
+    m_addressSent = false;
+    if (m_dma)
+    {
+        m_dmaStreams->rx.stop();
+        m_dmaStreams->tx.stop();
+    }
+    const auto busy = DWT::cycles() - m_startedAt;
+    m_devStats->busyCycles += busy;
+    m_windowBusy += busy;
+    m_current = nullptr;
+}
+
+void Engine::complete(Status s)
+{
+    auto* t = m_current;
+    switch (s)
+    {
+        case Status::NACK:    ++m_devStats->nacks; break;
+        case Status::TIMEOUT: ++m_devStats->timeouts; break;
+        case Status::ERROR:   ++m_devStats->errors; break;
+        default: break;
+    };
+    release();
+    if (s != Status::DONE && t->attempt < t->retries)
+    {
+        // The current chunk of a write starts over, a read starts from the first segment
+        ++t->attempt;
+        enqueue(*t);
+        startNext();
+        return;
+    }
+    ++m_devStats->transactions;
+    t->status = s;
+    // The callback may submit the next transaction itself
+    if (t->callback != nullptr)
+        t->callback(*t);
+    if (m_current == nullptr)
+        startNext();
+}
+
+// Target side: addressed by another controller while not driving the bus ourselves
+bool Engine::isTarget(uint32_t sr1) const
+{
+    if (!hasTarget())
+        return false;
+    return m_targetActive || (sr1 & SR1_STOPF) != 0 || ((sr1 & SR1_ADDR) != 0 && !m_addressSent);
+}
+
+void Engine::onTarget(uint32_t sr1)
+{
+    if ((sr1 & SR1_ADDR) != 0)
+    {
+        // Reading SR2 after SR1 clears ADDR
+        m_targetTx = (m_regs->SR2 & SR2_TRA) != 0;
+        m_targetActive = true;
+        m_target.onAddress(m_target.context, m_targetTx); // Transmitter when the controller reads
+        setBit(&m_regs->CR2, CR2_ITBUFEN);
+        return;
+    }
+    if (!m_targetTx && (sr1 & SR1_RXNE) != 0)
+        m_target.onWrite(m_target.context, static_cast<uint8_t>(m_regs->DR));
+    if (m_targetTx && (sr1 & SR1_TXE) != 0)
+        m_regs->DR = m_target.onRead(m_target.context);
+    if ((sr1 & SR1_STOPF) != 0)
+    {
+        setBit(&m_regs->CR1, CR1_PE); // STOPF is cleared by reading SR1 then writing CR1
+        endTarget();
+    }
+}
+
+void Engine::endTarget()
+{
+    clearBit(&m_regs->CR2, CR2_ITBUFEN);
+    m_targetActive = false;
+    m_target.onStop(m_target.context);
+}
+
+extern "C"
+void I2C1_EV_IRQHandler(void)
+{
+    engines[0].onEvent();
+}
+
+extern "C"
+void I2C1_ER_IRQHandler(void)
+{
+    engines[0].onError();
+}
+
+extern "C"
+void I2C2_EV_IRQHandler(void)
+{
+    engines[1].onEvent();
+}
+
+extern "C"
+void I2C2_ER_IRQHandler(void)
+{
+    engines[1].onError();
+}
+
+extern "C"
+void I2C3_EV_IRQHandler(void)
+{
+    engines[2].onEvent();
+}
+
+extern "C"
+void I2C3_ER_IRQHandler(void)
+{
+    engines[2].onError();
+}
+
+extern "C"
+void DMA1_Stream0_IRQHandler(void)
+{
+    engines[0].onDMA();
+}
+
+extern "C"
+void DMA1_Stream3_IRQHandler(void)
+{
+    engines[1].onDMA();
+}
+
+extern "C"
+void DMA1_Stream2_IRQHandler(void)
+{
+    engines[2].onDMA();
+}
+
+Engine* PortBase::engine(uint8_t num)
+{
+    return &engines[num - 1];
+}
 
 void PortBase::init()
 {
@@ -11,58 +877,96 @@ void PortBase::init()
     setCCR();
     setConfig();
     setOwnAddress();
+    m_engine->attach(this, m_regs, &dmaStreams[m_num - 1]);
+    enableIRQ();
     enable();
+    enableTarget();
 }
 
-bool PortBase::waitBusy()
+void PortBase::poll()
 {
-    return waitBitOff(&m_regs->SR2, BIT(1)); // Wait while BUSY
+    m_engine->poll();
 }
 
-bool PortBase::start()
+void PortBase::recover()
 {
-    setBit(&m_regs->CR1, BIT(8)); // START
-    return waitBitOn(&m_regs->SR1, BIT(0)); // Wait START
+    disable();
+    if (m_releaseBus != nullptr)
+        m_releaseBus();
+    init();
 }
 
-void PortBase::stop()
+bool PortBase::submit(Transaction& t)
 {
-    setBit(&m_regs->CR1, BIT(9)); // STOP
-    // STOP detection is only necessary in SLAVE mode
+    return m_engine->submit(t);
 }
 
-bool PortBase::writeAddress(uint8_t address, ReadWrite rw)
+void PortBase::setDMAThreshold(size_t size)
 {
-    if (rw == ReadWrite::READ)
-        m_regs->DR = (address << 1) + 1;
-    else
-        m_regs->DR = address << 1;
-    if (!waitBitOn(&m_regs->SR1, BIT(1))) // Wait ADDR
-        return false;
-    // Clear ADDR by reading SR1 and SR2
-    volatile uint32_t temp = 0;
-    temp = m_regs->SR1;
-    temp = m_regs->SR2;
-    (void) temp;
-    return true;
+    m_engine->setDMAThreshold(size);
 }
 
-bool PortBase::writeByte(uint8_t value)
+SchedulerStats PortBase::schedulerStats() const
 {
-    if (!waitBitOn(&m_regs->SR1, BIT(7))) // Wait TxE (maybe still transferring)
-        return false;
-    m_regs->DR = value;
-    return waitBitOn(&m_regs->SR1, BIT(7)); // Wait TxE
+    return m_engine->stats();
 }
 
-std::pair<bool, uint8_t> PortBase::readByte(AckNack ack)
+void PortBase::resetSchedulerStats()
 {
-    if (ack == AckNack::ACK)
-        setBit(&m_regs->CR1, BIT(10));
-    else
-        clearBit(&m_regs->CR1, BIT(10));
-    const auto success = waitBitOn(&m_regs->SR1, BIT(6)); // Wait RxNE
-    return {success, m_regs->DR};
+    m_engine->resetStats();
+}
+
+uint32_t PortBase::setSpeed(Speed s)
+{
+    const auto& next = m_timings[std::to_underlying(s)];
+    const auto& current = timing();
+    if (next.ccr != current.ccr || next.trise != current.trise)
+    {
+        // CCR and TRISE can be changed only with the peripheral disabled
+        disable();
+        m_speed = s;
+        setTRise();
+        setCCR();
+        enable();
+    }
+    m_speed = s;
+    return next.speed;
+}
+
+bool PortBase::tryLock(const void* owner)
+{
+    return m_engine->tryLock(owner);
+}
+
+void PortBase::lock(const void* owner)
+{
+    while (!tryLock(owner))
+        poll();
+}
+
+void PortBase::unlock(const void* owner)
+{
+    m_engine->unlock(owner);
+}
+
+BusStats PortBase::busStats() const
+{
+    return m_engine->busStats();
+}
+
+void PortBase::resetBusStats()
+{
+    m_engine->resetBusStats();
+}
+
+bool PortBase::isIdle() const
+{
+    return m_engine->isIdle();
+}
+
+bool PortBase::hasQueued() const
+{
+    return m_engine->hasQueued();
 }
 
 void PortBase::disable()
@@ -83,28 +987,21 @@ void PortBase::reset()
 
 void PortBase::setFreq()
 {
-    const auto val = static_cast<uint8_t>(m_PFreq);
     clearBit(&m_regs->CR2, 0x0000003F);
-    setBit(&m_regs->CR2, val & 0x0000003F);
+    setBit(&m_regs->CR2, timing().freq & 0x0000003F);
 }
 
 void PortBase::setTRise()
 {
-    // Master/Sm
-    const auto val = static_cast<uint8_t>(m_PFreq) + 1;
     clearBit(&m_regs->TRISE, 0x0000003F);
-    setBit(&m_regs->TRISE, val & 0x0000003F);
+    setBit(&m_regs->TRISE, timing().trise & 0x0000003F);
 }
 
 void PortBase::setCCR()
 {
-    // Master/Sm
-    const auto val = static_cast<uint16_t>(m_PFreq * 1000000 / (m_speed * 2));
-    clearBit(&m_regs->CCR, 0x00000FFF);
-    setBit(&m_regs->CCR, val & 0x00000FFF);
-
-    // Set Sm, reset Duty
-    clearBit(&m_regs->CCR, 0x0000C000);
+    // CCR value, F/S and DUTY
+    clearBit(&m_regs->CCR, 0x0000CFFF);
+    setBit(&m_regs->CCR, timing().ccr & 0x0000CFFF);
 }
 
 void PortBase::setConfig()
@@ -117,6 +1014,40 @@ void PortBase::setOwnAddress()
 {
     clearBit(&m_regs->OAR1, 0x00009000); // Set 7-bit addressing mode
     clearBit(&m_regs->OAR1, 0x00003FFF); // ADDR8-9, ADDR and ADDR0 are zero
+    setBit(&m_regs->OAR1, BIT(14));      // Must be kept at 1 by software
+    setBit(&m_regs->OAR1, (m_ownAddress & 0x7F) << 1);
 
     clearBit(&m_regs->OAR2, 0x000000FF); // No Dual mode, zero OAR2
+    if (m_ownAddress2 != 0)
+        setBit(&m_regs->OAR2, ((m_ownAddress2 & 0x7F) << 1) | BIT(0)); // ENDUAL
+}
+
+void PortBase::setTarget(uint8_t address, uint8_t address2, const TargetHandlers& handlers)
+{
+    m_ownAddress = address;
+    m_ownAddress2 = address2;
+    m_engine->setTarget(handlers);
+    init();
+}
+
+// ACK is cleared together with PE, the engine restores it after each own transaction
+void PortBase::enableTarget()
+{
+    if (m_ownAddress == 0)
+        return;
+    setBit(&m_regs->CR1, CR1_ACK);
+    setBit(&m_regs->CR2, CR2_ITEVTEN | CR2_ITERREN);
+}
+
+void PortBase::enableIRQ()
+{
+    using IRQ = NVIC::IRQ;
+    DMA::enable(DMA::DMA1);
+    NVIC::enable(dmaStreams[m_num - 1].rxIRQ);
+    switch (m_num)
+    {
+        case 1: NVIC::enable(IRQ::I2C1_EV); NVIC::enable(IRQ::I2C1_ER); break;
+        case 2: NVIC::enable(IRQ::I2C2_EV); NVIC::enable(IRQ::I2C2_ER); break;
+        case 3: NVIC::enable(IRQ::I2C3_EV); NVIC::enable(IRQ::I2C3_ER); break;
+    };
 }
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "i2ctiming.h"
+#include "dwt.h"
 #include "gpio.h"
 #include "rcc.h"
 
+#include <array>
 #include <utility>
 #include <cstdint>
 #include <cstddef> // size_t
@@ -10,8 +13,10 @@
 namespace I2C
 {
 
-enum class ReadWrite { READ, WRITE };
-enum class AckNack { ACK, NACK };
+enum class Status : uint8_t { IDLE, PENDING, DONE, NACK, ERROR, TIMEOUT };
+enum class Priority : uint8_t { LOW = 0, NORMAL = 1, HIGH = 2 };
+// PORT - the speed mode the port was created with
+enum class Speed : uint8_t { PORT = 0, STANDARD = 1, FAST = 2 };
 
 struct Regs
 {
@@ -65,63 +70,227 @@ struct Pins<3>
     constexpr static uint8_t SCL_AF = 4;
 };
 
+/*
+ * A single master transaction: START, address+W, register number, then either
+ * writing `size` bytes from `tx` or a repeated START, address+R and reading
+ * into `segments`, then STOP.
+ * The whole sequence is driven by I2Cx_EV/I2Cx_ER interrupts, the optional
+ * callback is called from the ISR when the transaction is finished.
+ * Transactions are queued by priority. Writes with non-zero `chunk` are sent
+ * as several bus transactions of at most `chunk` bytes each, so a higher
+ * priority transaction can get the bus in between.
+ * Failed transactions are restarted up to `retries` times.
+ */
+// A run of registers read into its own buffer
+struct Segment
+{
+    uint8_t regNum;
+    void* buf;
+    size_t size;
+};
+
+struct Transaction
+{
+    using Callback = void (*)(Transaction&);
+
+    uint8_t address = 0;
+    uint8_t regNum = 0;
+    const uint8_t* tx = nullptr;
+    size_t size = 0;
+    // Reads: contiguous segments are merged into one burst, the rest are chained with repeated STARTs
+    const Segment* segments = nullptr;
+    size_t segmentCount = 0;
+    bool autoIncrement = true; // Device advances the register pointer during burst reads
+    Priority priority = Priority::NORMAL;
+    size_t chunk = 0;
+    Speed speed = Speed::PORT;
+    uint32_t timeout = 0; // Per phase, ms, 0 - derived from the bus speed
+    uint8_t retries = 0;
+    const void* owner = nullptr; // Transactions of the bus owner only while the bus is locked
+    Callback callback = nullptr;
+    void* context = nullptr;
+    volatile Status status = Status::IDLE;
+
+    // Scheduler state
+    size_t offset = 0;
+    uint8_t attempt = 0;
+    uint32_t queuedAt = 0;
+    Transaction* next = nullptr;
+
+    bool isRead() const { return segments != nullptr; }
+    bool isPending() const { return status == Status::PENDING; }
+};
+
+struct SchedulerStats
+{
+    size_t depth = 0;    // Transactions waiting for the bus
+    size_t maxDepth = 0;
+    std::array<uint32_t, 3> maxWait{}; // Worst time from submit to START per priority, CPU cycles
+};
+
+// Counters of a single slave, failures are counted per attempt
+struct DeviceStats
+{
+    uint8_t address = 0;
+    uint32_t transactions = 0; // Finished, including failed ones
+    uint32_t bytesTx = 0;      // Register numbers and data, without address bytes
+    uint32_t bytesRx = 0;
+    uint32_t nacks = 0;
+    uint32_t timeouts = 0;
+    uint32_t errors = 0;
+    uint32_t recoveries = 0;
+    uint64_t busyCycles = 0;   // From START to STOP, CPU cycles
+};
+
+struct BusStats
+{
+    static constexpr size_t MAX_DEVICES = 4;
+
+    size_t devices = 0;
+    std::array<DeviceStats, MAX_DEVICES> perDevice{};
+    DeviceStats untracked; // Addresses that didn't fit
+    uint8_t utilization = 0; // Busy time over the last window, percent
+};
+
+// Target (slave) side of a port. Called from the ISR, must not block.
+struct TargetHandlers
+{
+    void (*onAddress)(void* context, bool read) = nullptr; // read - the controller reads
+    void (*onWrite)(void* context, uint8_t b) = nullptr;
+    uint8_t (*onRead)(void* context) = nullptr;
+    void (*onStop)(void* context) = nullptr; // STOP or NACK of the last byte read
+    void* context = nullptr;
+};
+
+class Engine;
+
 class PortBase
 {
     public:
-        PortBase(uint8_t num, double pFreq, uint32_t speed)
+        using ReleaseBus = void (*)();
+
+        using Timings = std::array<Timing, 3>; // Indexed by Speed
+
+        PortBase(uint8_t num, const Timings& timings, ReleaseBus releaseBus = nullptr)
             : m_regs(getRegs(num)),
               m_num(num),
-              m_PFreq(pFreq),
-              m_speed(speed)
+              m_timings(timings),
+              m_speed(Speed::PORT),
+              m_releaseBus(releaseBus),
+              m_engine(engine(num))
         {
         }
 
-        PortBase(const PortBase&) = default;
-        PortBase(PortBase&&) = default;
-
-        PortBase& operator=(const PortBase&) = default;
-        PortBase& operator=(PortBase&&) = default;
+        // The port is the bus, devices share it by reference
+        PortBase(const PortBase&) = delete;
+        PortBase& operator=(const PortBase&) = delete;
 
         void init();
 
-        bool waitBusy();
-        bool start();
-        void stop();
+        // Non-blocking, returns false if the transaction is already queued or malformed
+        bool submit(Transaction& t);
+        bool isIdle() const;
+        // Transactions waiting for the bus besides the current one
+        bool hasQueued() const;
+
+        SchedulerStats schedulerStats() const;
+        void resetSchedulerStats();
+
+        // Utilization is updated by poll() once a second
+        BusStats busStats() const;
+        void resetBusStats();
+
+        // Aborts the current transaction with TIMEOUT and recovers the bus
+        // if it went past its deadline. Must be called periodically.
+        void poll();
+        // Frees SDA from a stuck slave and reinitializes the peripheral
+        void recover();
+
+        // Transfers of at least this many bytes go through DMA (minimum is 2)
+        void setDMAThreshold(size_t size);
 
-        bool writeAddress(uint8_t address, ReadWrite rw);
-        bool writeByte(uint8_t value);
-        std::pair<bool, uint8_t> readByte(AckNack ack);
+        // Reprograms the clock control registers if the speed differs from the current one.
+        // Must be called only when the bus is idle. Returns SCL frequency.
+        uint32_t setSpeed(Speed s);
+
+        // While the bus is locked only the owner's transactions are started,
+        // the rest stay queued. Locking is not recursive.
+        bool tryLock(const void* owner);
+        void lock(const void* owner);
+        void unlock(const void* owner);
+
+        // Answers on the own address(es) between own transactions, address2 = 0 - OAR2 is unused.
+        // Target provides onAddress(bool), onWrite(uint8_t), onRead() and onStop().
+        // Must be called only when the bus is idle, reinitializes the peripheral.
+        template <typename Target>
+        void setTarget(uint8_t address, Target& target, uint8_t address2 = 0)
+        {
+            setTarget(address, address2, {
+                [](void* c, bool read) { static_cast<Target*>(c)->onAddress(read); },
+                [](void* c, uint8_t b) { static_cast<Target*>(c)->onWrite(b); },
+                [](void* c) { return static_cast<Target*>(c)->onRead(); },
+                [](void* c) { static_cast<Target*>(c)->onStop(); },
+                &target
+            });
+        }
+        void setTarget(uint8_t address, uint8_t address2, const TargetHandlers& handlers);
 
     private:
         Regs* m_regs;
         size_t m_num;
-        double m_PFreq;
-        uint32_t m_speed;
+        Timings m_timings;
+        Speed m_speed;
+        uint8_t m_ownAddress = 0;
+        uint8_t m_ownAddress2 = 0;
+        ReleaseBus m_releaseBus;
+        Engine* m_engine;
+
+        static Engine* engine(uint8_t num);
 
         void disable();
         void enable();
 
         void reset();
 
+        const Timing& timing() const { return m_timings[std::to_underlying(m_speed)]; }
+
         void setFreq();
         void setTRise();
         void setCCR();
         void setConfig();
         void setOwnAddress();
+        void enableIRQ();
+        void enableTarget();
 };
 
-template <uint8_t Num>
+/*
+ * Template parameters:
+ * Num   - peripheral number, 1-3;
+ * Clock - Clocks::SysClock the APB1 clock is taken from;
+ * Mode  - speed mode tag: Standard<>, Fast<> or FastDuty16_9<>;
+ * PinsT - SDA/SCL pins and their AF numbers, for alternative pin mappings.
+ */
+template <uint8_t Num, typename Clock, typename Mode = Standard<>, typename PinsT = Pins<Num>>
 class Port : public PortBase
 {
     public:
         static constexpr auto num = Num;
 
-        using PinsDef = Pins<Num>;
+        using PinsDef = PinsT;
         using SDA = PinsDef::SDA;
         using SCL = PinsDef::SCL;
+        static constexpr std::array<uint16_t, 2> pins = {SDA::code, SCL::code};
+        using TimingDef = TimingFor<Clock, Mode>;
 
-        Port(double pFreq, uint32_t speed)
-            : PortBase(num, pFreq, speed)
+        // Speeds available to devices
+        static constexpr Timings timings = {
+            TimingDef::value,
+            TimingFor<Clock, Standard<>>::value,
+            TimingFor<Clock, Fast<>>::value
+        };
+
+        Port()
+            : PortBase(num, timings, releaseBus)
         {
             // GPIO
             enableGPIO();
@@ -153,13 +322,54 @@ class Port : public PortBase
             SCL::setPull(GPIO::Pull::UP);
             SCL::setSpeed(GPIO::Speed::VERY_HIGH);
         }
+
+        // 5 us, the recovery clocks SCL at 100 kHz which any slave accepts
+        static constexpr uint32_t halfPeriodCycles = static_cast<uint32_t>(Clock::AHBFreq * 5);
+
+        static void halfPeriod()
+        {
+            const auto start = DWT::cycles();
+            while (DWT::cycles() - start < halfPeriodCycles)
+                asm("nop");
+        }
+
+        // Bus recovery (UM10204, 3.1.16): clock SCL until the slave lets SDA go,
+        // at most 9 times, then generate STOP and give the pins back to I2C.
+        static void releaseBus()
+        {
+            SDA::set(true);
+            SCL::set(true);
+            SDA::setMode(GPIO::Mode::OUTPUT);
+            SCL::setMode(GPIO::Mode::OUTPUT);
+            halfPeriod();
+
+            for (size_t i = 0; i < 9 && !SDA::get(); ++i)
+            {
+                SCL::set(false);
+                halfPeriod();
+                SCL::set(true);
+                halfPeriod();
+            }
+
+            // STOP: SDA goes up while SCL is high
+            SCL::set(false);
+            halfPeriod();
+            SDA::set(false);
+            halfPeriod();
+            SCL::set(true);
+            halfPeriod();
+            SDA::set(true);
+            halfPeriod();
+
+            configureGPIO();
+        }
 };
 
 template <typename T>
 struct isPort : std::false_type {};
 
-template <uint8_t Num>
-struct isPort<Port<Num>> : std::true_type {};
+template <uint8_t Num, typename Clock, typename Mode, typename PinsT>
+struct isPort<Port<Num, Clock, Mode, PinsT>> : std::true_type {};
 
 template <typename T>
 inline constexpr bool isPort_v = isPort<T>::value;
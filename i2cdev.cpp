@@ -2,68 +2,74 @@
 
 using Device = I2C::Device;
 
-bool Device::readRegs(uint8_t regNum, void* buf, size_t size)
+bool Device::readRegs(uint8_t regNum, void* buf, size_t size, Transaction::Callback cb, void* context)
 {
-    // Send preamble
-    if (!preamble(regNum))
+    if (m_transaction.isPending())
         return false;
+    m_segment = {regNum, buf, size};
+    return readRegs(std::span(&m_segment, 1), cb, context);
+}
 
-    // Request data
-    if (!m_port.start())
-        return false;
-    if (!m_port.writeAddress(m_address, ReadWrite::READ))
+bool Device::readRegs(std::span<const Segment> segments, Transaction::Callback cb, void* context)
+{
+    if (segments.empty() || m_transaction.isPending())
         return false;
 
-    // Read data
-    size_t i = 0;
-    for (;i < size - 1; ++i)
-        if (!readByte(buf, i, AckNack::ACK))
-            return false;
-    // Last byte with NACK
-    if (!readByte(buf, i, AckNack::NACK))
+    m_transaction.regNum = segments.front().regNum;
+    m_transaction.tx = nullptr;
+    m_transaction.size = 0;
+    m_transaction.segments = segments.data();
+    m_transaction.segmentCount = segments.size();
+    m_transaction.autoIncrement = m_autoIncrement;
+    m_transaction.chunk = 0;
+    return submit(cb, context);
+}
+
+bool Device::writeRegs(uint8_t regNum, const void* data, size_t size, Transaction::Callback cb, void* context)
+{
+    if (m_transaction.isPending())
         return false;
 
-    m_port.stop();
-    return true;
+    m_transaction.regNum = regNum;
+    m_transaction.tx = static_cast<const uint8_t*>(data);
+    m_transaction.size = size;
+    m_transaction.segments = nullptr;
+    m_transaction.segmentCount = 0;
+    m_transaction.chunk = m_chunk;
+    return submit(cb, context);
 }
 
-bool Device::writeRegs(uint8_t regNum, const void* data, size_t size)
+bool Device::wait()
 {
-    // Send preamble
-    if (!preamble(regNum))
-        return false;
+    while (m_transaction.isPending())
+        m_port.poll(); // Deadline check, the transaction ends with TIMEOUT at worst
+    return m_transaction.status == Status::DONE;
+}
 
-    // Send data
-    for (size_t i = 0; i < size; ++i)
-    {
-        const auto byte = static_cast<const uint8_t*>(data)[i];
-        if (!m_port.writeByte(byte))
-            return false;
-    }
+bool Device::read(uint8_t regNum, void* buf, size_t size)
+{
+    return readRegs(regNum, buf, size) && wait();
+}
 
-    m_port.stop();
-    return true;
+bool Device::read(std::span<const Segment> segments)
+{
+    return readRegs(segments) && wait();
 }
 
-bool Device::preamble(uint8_t regNum)
+bool Device::write(uint8_t regNum, const void* data, size_t size)
 {
-    if (!m_port.waitBusy())
-        return false;
-    if (!m_port.start())
-        return false;
-    if (!m_port.writeAddress(m_address, ReadWrite::WRITE))
-        return false;
-    if (!m_port.writeByte(regNum))
-        return false;
-    return true;
+    return writeRegs(regNum, data, size) && wait();
 }
 
-bool Device::readByte(void* buf, size_t i, AckNack ack)
+bool Device::submit(Transaction::Callback cb, void* context)
 {
-    auto* bytePtr = static_cast<uint8_t*>(buf) + i;
-    const auto res = m_port.readByte(ack);
-    if (!std::get<0>(res))
-        return false;
-    *bytePtr = std::get<1>(res);
-    return true;
+    m_transaction.address = m_address;
+    m_transaction.priority = m_priority;
+    m_transaction.speed = m_speed;
+    m_transaction.timeout = m_timeout;
+    m_transaction.retries = m_retries;
+    m_transaction.owner = this;
+    m_transaction.callback = cb;
+    m_transaction.context = context;
+    return m_port.submit(m_transaction);
 }
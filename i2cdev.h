@@ -2,16 +2,31 @@
 
 #include "i2c.h"
 
-#include <tuple>
+#include <span>
 #include <cstdint>
 
 namespace I2C
 {
 
+// A slave on a shared bus, transactions carry the per-device settings
 class Device
 {
 
     public:
+        // Keeps the bus for a sequence of transactions of the device
+        class Lock
+        {
+            public:
+                explicit Lock(Device& dev) : m_dev(dev) { m_dev.lock(); }
+                ~Lock() { m_dev.unlock(); }
+
+                Lock(const Lock&) = delete;
+                Lock& operator=(const Lock&) = delete;
+
+            private:
+                Device& m_dev;
+        };
+
         template <typename Port>
         Device(Port& port, uint8_t address)
             : m_port(port),
@@ -20,18 +35,55 @@ class Device
             static_assert(isPort_v<Port>, "Port must be an I2C port");
         }
 
-        bool readRegs(uint8_t regNum, void* buf, size_t size);
-        bool writeRegs(uint8_t regNum, const void* data, size_t size);
+        // Non-blocking, the buffer must stay valid until the transaction is finished.
+        // The callback is called from the ISR.
+        bool readRegs(uint8_t regNum, void* buf, size_t size, Transaction::Callback cb = nullptr, void* context = nullptr);
+        bool writeRegs(uint8_t regNum, const void* data, size_t size, Transaction::Callback cb = nullptr, void* context = nullptr);
+        // Scatter read in a single transaction, the segment list must stay valid as well
+        bool readRegs(std::span<const Segment> segments, Transaction::Callback cb = nullptr, void* context = nullptr);
+
+        bool isBusy() const { return m_transaction.isPending(); }
+        // Other transactions are waiting for the bus
+        bool isContended() const { return m_port.hasQueued(); }
+        bool wait();
+        void poll() { m_port.poll(); }
+
+        void setPriority(Priority p) { m_priority = p; }
+        // Writes larger than this are split into several bus transactions, 0 - never split
+        void setChunkSize(size_t size) { m_chunk = size; }
+        // Devices without register auto-increment get a separate burst per segment
+        void setAutoIncrement(bool v) { m_autoIncrement = v; }
+        // The bus is reprogrammed only if the previous transaction ran at a different speed
+        void setSpeed(Speed s) { m_speed = s; }
+        // Per phase, ms, 0 - derived from the bus speed
+        void setTimeout(uint32_t ms) { m_timeout = ms; }
+        // How many times a failed transaction is restarted
+        void setRetries(uint8_t n) { m_retries = n; }
+
+        void lock() { m_port.lock(this); }
+        void unlock() { m_port.unlock(this); }
+
+        // Blocking
+        bool read(uint8_t regNum, void* buf, size_t size);
+        bool write(uint8_t regNum, const void* data, size_t size);
+        bool read(std::span<const Segment> segments);
 
-        bool readReg(uint8_t regNum, uint8_t& value) { return readRegs(regNum, &value, 1); }
-        bool writeReg(uint8_t regNum, uint8_t value) { return writeRegs(regNum, &value, 1); }
+        bool readReg(uint8_t regNum, uint8_t& value) { return read(regNum, &value, 1); }
+        bool writeReg(uint8_t regNum, uint8_t value) { return write(regNum, &value, 1); }
 
     private:
-        I2C::PortBase m_port;
+        I2C::PortBase& m_port;
         uint8_t m_address;
+        Priority m_priority = Priority::NORMAL;
+        size_t m_chunk = 0;
+        bool m_autoIncrement = true;
+        Speed m_speed = Speed::PORT;
+        uint32_t m_timeout = 0;
+        uint8_t m_retries = 0;
+        Segment m_segment{}; // Single register range reads
+        Transaction m_transaction;
 
-        bool preamble(uint8_t regNum);
-        bool readByte(void* buf, size_t i, AckNack ack);
+        bool submit(Transaction::Callback cb, void* context);
 };
 
 }
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "utils.h" // BIT
+
+#include <cstdint>
+
+/*
+ * What the controller side does about an error interrupt of its own
+ * transaction (RM0368, 18.3.8). The bus is shared with another controller
+ * and the monitor answers as a target, so losing arbitration is normal.
+ */
+
+namespace I2C
+{
+
+// SR1 error flags
+constexpr auto SR1_BERR = BIT(8);
+constexpr auto SR1_ARLO = BIT(9);
+constexpr auto SR1_AF   = BIT(10);
+constexpr auto SR1_OVR  = BIT(11);
+
+enum class ErrorAction : uint8_t
+{
+    NACK,   // The slave refused, STOP and finish with NACK
+    RETRY,  // Another controller won, the peripheral has left the bus: no STOP, no recovery
+    RECOVER // Misplaced START/STOP or overrun, the bus is in an unknown state
+};
+
+constexpr ErrorAction errorAction(uint32_t sr1)
+{
+    if ((sr1 & SR1_AF) != 0)
+        return ErrorAction::NACK;
+    if ((sr1 & SR1_ARLO) != 0 && (sr1 & (SR1_BERR | SR1_OVR)) == 0)
+        return ErrorAction::RETRY;
+    return ErrorAction::RECOVER;
+}
+
+}
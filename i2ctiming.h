@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Compile-time derivation of I2C timing registers (RM0368, 18.6.8 - 18.6.9).
+ *
+ * using Timing = I2C::TimingFor<SysClock, I2C::Fast<>>;
+ * Timing::value.ccr ...
+ */
+
+namespace I2C
+{
+
+// Raw register values and the resulting bus speed
+struct Timing
+{
+    uint8_t freq;   // CR2.FREQ, APB1 clock in MHz
+    uint8_t trise;  // TRISE
+    uint16_t ccr;   // CCR, including F/S and DUTY bits
+    uint32_t speed; // SCL frequency, Hz
+};
+
+/*
+ * Speed mode tags.
+ * SCL low and high periods are lowTicks * CCR and highTicks * CCR of APB1 clock.
+ */
+template <uint32_t Speed = 100000>
+struct Standard
+{
+    static constexpr uint32_t speed = Speed;
+    static constexpr uint32_t maxSpeed = 100000;
+    static constexpr uint32_t lowTicks = 1;
+    static constexpr uint32_t highTicks = 1;
+    static constexpr uint32_t minFreq = 2;    // MHz
+    static constexpr uint32_t maxRise = 1000; // ns
+    static constexpr uint32_t minLow = 4700;  // ns
+    static constexpr uint32_t minHigh = 4000; // ns
+    static constexpr uint32_t minCCR = 4;
+    static constexpr uint16_t modeBits = 0x0000;
+};
+
+// Fm, Tlow/Thigh = 2
+template <uint32_t Speed = 400000>
+struct Fast
+{
+    static constexpr uint32_t speed = Speed;
+    static constexpr uint32_t maxSpeed = 400000;
+    static constexpr uint32_t lowTicks = 2;
+    static constexpr uint32_t highTicks = 1;
+    static constexpr uint32_t minFreq = 4;   // MHz
+    static constexpr uint32_t maxRise = 300; // ns
+    static constexpr uint32_t minLow = 1300; // ns
+    static constexpr uint32_t minHigh = 600; // ns
+    static constexpr uint32_t minCCR = 1;
+    static constexpr uint16_t modeBits = 0x8000; // F/S
+};
+
+// Fm, Tlow/Thigh = 16/9
+template <uint32_t Speed = 400000>
+struct FastDuty16_9 : Fast<Speed>
+{
+    static constexpr uint32_t lowTicks = 16;
+    static constexpr uint32_t highTicks = 9;
+    static constexpr uint16_t modeBits = 0xC000; // F/S + DUTY
+};
+
+template <typename Clock, typename Mode>
+struct TimingFor
+{
+    static constexpr uint32_t pclk = static_cast<uint32_t>(Clock::APB1Freq * 1000000);
+    static constexpr uint32_t freq = pclk / 1000000;
+    static constexpr uint32_t ticks = Mode::lowTicks + Mode::highTicks;
+    // Rounded up, so the bus is never faster than requested
+    static constexpr uint32_t ccr = (pclk + ticks * Mode::speed - 1) / (ticks * Mode::speed);
+    static constexpr uint32_t trise = freq * Mode::maxRise / 1000 + 1;
+
+    static constexpr uint32_t speed = pclk / (ticks * ccr);
+    static constexpr uint64_t lowNs = 1000000000ULL * Mode::lowTicks * ccr / pclk;
+    static constexpr uint64_t highNs = 1000000000ULL * Mode::highTicks * ccr / pclk;
+
+    static_assert(Mode::speed > 0 && Mode::speed <= Mode::maxSpeed, "Bus speed is out of range for the mode");
+    static_assert(pclk % 1000000 == 0, "APB1 clock must be a whole number of MHz");
+    static_assert(freq >= Mode::minFreq, "APB1 clock is too slow for the mode");
+    static_assert(freq <= 50, "APB1 clock must not exceed 50 MHz");
+    static_assert(ccr >= Mode::minCCR && ccr <= 0xFFF, "CCR is out of range");
+    static_assert(trise <= 0x3F, "TRISE is out of range");
+    static_assert(lowNs >= Mode::minLow, "SCL low period is too short");
+    static_assert(highNs >= Mode::minHigh, "SCL high period is too short");
+
+    static constexpr Timing value = {
+        static_cast<uint8_t>(freq),
+        static_cast<uint8_t>(trise),
+        static_cast<uint16_t>(ccr | Mode::modeBits),
+        speed
+    };
+};
+
+}
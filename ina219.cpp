@@ -1,22 +1,29 @@
 #include "ina219.h"
 
+#include "byteorder.h"
+
 void INA219::init()
 {
 }
 
+// All 4 registers in one transaction, chained with repeated STARTs
 bool INA219::readData(uint16_t& v, uint16_t& vs, uint16_t& c, uint16_t& p)
 {
-    return readMSB(0x01, vs)
-        && readMSB(0x02, v)
-        && readMSB(0x03, p)
-        && readMSB(0x04, c);
-}
-
-bool INA219::readMSB(uint8_t regNum, uint16_t& value)
-{
-    std::array<uint8_t, 2> data;
-    if (!m_dev.readRegs(regNum, data.data(), data.size()))
+    BE<uint16_t> shunt;
+    BE<uint16_t> bus;
+    BE<uint16_t> power;
+    BE<uint16_t> current;
+    const I2C::Segment segments[] = {
+        {0x01, &shunt, sizeof(shunt)},
+        {0x02, &bus, sizeof(bus)},
+        {0x03, &power, sizeof(power)},
+        {0x04, &current, sizeof(current)}
+    };
+    if (!m_dev.read(segments))
         return false;
-    value = (data[0] << 8) + data[1];
+    vs = shunt;
+    v = bus;
+    p = power;
+    c = current;
     return true;
 }
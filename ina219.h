@@ -1,3 +1,5 @@
+#pragma once
+
 #include "i2cdev.h"
 
 class INA219
@@ -7,6 +9,9 @@ class INA219
         INA219(Port& port, uint8_t address)
             : m_dev(port, address)
         {
+            m_dev.setPriority(I2C::Priority::HIGH);
+            m_dev.setRetries(2);
+            m_dev.setAutoIncrement(false); // Register pointer stays put, 2 bytes per register
         }
 
         void init();
@@ -14,6 +19,4 @@ class INA219
         bool readData(uint16_t& v, uint16_t& vs, uint16_t& c, uint16_t& p);
     private:
         I2C::Device m_dev;
-
-        bool readMSB(uint8_t regNum, uint16_t& v);
 };
@@ -3,11 +3,21 @@
 #include "button.h"
 #include "gpio.h"
 
+#include <array>
 #include <optional>
+#include <cstdint>
 
 class Keyboard
 {
     public:
+        using EnterPin = GPIO::Pin<'B', 2>;
+        using PlusPin  = GPIO::Pin<'B', 3>;
+        using MinusPin = GPIO::Pin<'B', 4>;
+        using ExitPin  = GPIO::Pin<'B', 5>;
+
+        // Pin codes taken by the keyboard
+        static constexpr std::array<uint16_t, 4> pins = {EnterPin::code, PlusPin::code, MinusPin::code, ExitPin::code};
+
         enum class Action { Enter, Plus, Minus, Exit };
         enum class LEDAction { On, Off };
 
@@ -26,10 +36,10 @@ class Keyboard
         */
 
     private:
-        using EnterBtn  = Buttons::Button<GPIO::Pin<'B', 2>>;
-        using PlusBtn  = Buttons::Button<GPIO::Pin<'B', 3>>;
-        using MinusBtn = Buttons::Button<GPIO::Pin<'B', 4>>;
-        using ExitBtn   = Buttons::Button<GPIO::Pin<'B', 5>>;
+        using EnterBtn  = Buttons::Button<EnterPin>;
+        using PlusBtn  = Buttons::Button<PlusPin>;
+        using MinusBtn = Buttons::Button<MinusPin>;
+        using ExitBtn   = Buttons::Button<ExitPin>;
 
         bool m_ledState = false;
 
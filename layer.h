@@ -0,0 +1,66 @@
+#pragma once
+
+#include "gfx.h"
+#include "fonts.h"
+
+#include <string_view>
+#include <cstdint>
+#include <cstddef> // size_t
+
+/*
+ * Static screen content rasterized at compile time: labels, lines and
+ * frames that never change. A constexpr layer lives in flash and a frame
+ * starts with a copy of it (BasicDisplay::fill(layer)) instead of clearing
+ * and drawing it again, the dynamic part goes on top.
+ *
+ * Pixels are set one by one, which is slow but costs nothing at run time.
+ *
+ * Template parameters:
+ * W, H - layer size in pixels, H is a whole number of pages.
+ */
+template <size_t W, size_t H>
+class Layer
+{
+    public:
+        using Pages = Gfx::Pages<W, H / 8>;
+
+        // Same placement as BasicDisplay::printAt()
+        constexpr Layer& text(int x, int y, const Font& font, std::string_view s, size_t interCharSpace = 1)
+        {
+            for (auto c : s)
+            {
+                const auto g = font.glyph(c);
+                const auto w = static_cast<int>(font.advance(c));
+                for (int col = 0; col < w; ++col)
+                    for (size_t row = 0; row < g.h; ++row)
+                    {
+                        const auto bit = static_cast<size_t>(col) * g.step + row;
+                        if ((g.columns[bit / 8] >> (bit % 8)) & 1)
+                            Gfx::plot(m_pages, x + col, y + static_cast<int>(row), 0xFF, Gfx::Rop::Or);
+                    }
+                x += w + static_cast<int>(interCharSpace);
+            }
+            return *this;
+        }
+
+        constexpr Layer& hline(int x, int y, int l)
+        {
+            for (int i = 0; i < l; ++i)
+                Gfx::plot(m_pages, x + i, y, 0xFF, Gfx::Rop::Or);
+            return *this;
+        }
+
+        constexpr Layer& vline(int x, int y, int l)
+        {
+            for (int i = 0; i < l; ++i)
+                Gfx::plot(m_pages, x, y + i, 0xFF, Gfx::Rop::Or);
+            return *this;
+        }
+
+        constexpr const Pages& pages() const { return m_pages; }
+
+    private:
+        static_assert(H % 8 == 0, "Height must be a whole number of pages");
+
+        Pages m_pages{};
+};
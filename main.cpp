@@ -1,3 +1,4 @@
+#include "board.h"
 #include "gpio.h"
 #include "mco.h"
 #include "led.h"
@@ -13,6 +14,7 @@
 #include "timer.h"
 #include "clocks.h"
 #include "utils.h"
+#include "dwt.h"
 
 #include <chrono>
 
@@ -24,11 +26,9 @@ void SystemInit()
 using LED = LEDs::LED<GPIO::Pin<'C', 13>>; // Blue LED
 //using LED2 = GPIO::Pin<'A', 0>;           // Red LED
 using MCO1 = MCO::Port<1>;
-using HSE = Clocks::HSE<25.0>;
-using LSE = Clocks::LSE<32.768>;
-using PLL = Clocks::PLL<HSE, 25, 336, 4, 7>;
-using SysClock = Clocks::SysClock<PLL, Clocks::HPRE::DIV2, Clocks::PPRE::DIV2, Clocks::PPRE::DIV1>;
-using I2C1 = I2C::Port<1>;
+using LSE = Board::LSE;
+using SysClock = Board::SysClock;
+using I2C1 = Board::I2C1;
 
 namespace
 {
@@ -95,12 +95,13 @@ int main()
     LSE::enable();
     SysClock::enable();
     SysTick::init(SysClock::AHBFreq * 1000); // MHz to ms
+    DWT::enable();
     //LED led;
     //Keyboard keyboard;
 
     MCO1::enable(MCO1::Source::HSE, MCO::PRE::DIV5);
 
-    //auto port = I2C1(SysClock::APB1Freq, 100000);
+    //auto port = I2C1();
     ADC::init(ADC::PRE::DIV1);
     ADC::setIntChannel(ADC::IntChannel::TSVREF);
     auto adc = ADC::Device::create<ADC::ADC1>();
@@ -117,7 +118,7 @@ int main()
 
     //Fonts fonts;
 
-    Screen screen(SysClock::APB1Freq);
+    Screen screen;
 
     screen.run();
 
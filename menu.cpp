@@ -3,11 +3,12 @@
 #include "timer.h"
 #include "display.h"
 #include "fonts.h"
+#include "layer.h"
 #include "keyboard.h"
 #include "rtc.h"
 #include "datetime.h"
-#include "utils.h" // lz
 
+#include <algorithm> // std::min
 #include <chrono>
 #include <utility> // std::unreachable
 
@@ -54,10 +55,12 @@ void decInRange(uint8_t& v, uint8_t l, uint8_t h)
 
 }
 
-Menu::Menu(Display& d, Fonts& f, Keyboard& k)
-    : m_display(d),
+Menu::Menu(Board::BusSet& b, Display& d, Fonts& f, Keyboard& k, uint32_t maxFps)
+    : m_buses(b),
+      m_display(d),
       m_fonts(f),
-      m_keyboard(k)
+      m_keyboard(k),
+      m_frameRate(maxFps)
 {
 }
 
@@ -66,11 +69,16 @@ void Menu::run()
     show();
     while (true)
     {
+        m_buses.poll();
+        m_display.poll();
+        pollFrameRate();
         const auto e = m_keyboard.get();
+        if (!e.action)
+            continue;
         using Action = Keyboard::Action;
-        switch (e.action.value())
+        switch (*e.action)
         {
-            case Action::Enter: runEdit(); break;
+            case Action::Enter: runEdit(); show(); break;
             case Action::Plus:  nextMenu(); show(); break;
             case Action::Minus: prevMenu(); show(); break;
             case Action::Exit:  return;
@@ -80,17 +88,16 @@ void Menu::run()
 
 void Menu::show()
 {
-    m_display.clear();
+    static_assert(Fonts::medium.contains("Set date") && Fonts::medium.contains("Set time"), "Glyphs missing in Charset::menu");
+    using L = Layer<Display::width, Display::height>;
+    static constexpr auto date = L().text(75, 2, Fonts::medium, "Set date").pages();
+    static constexpr auto time = L().text(75, 2, Fonts::medium, "Set time").pages();
     switch (m_edit)
     {
-        case Edit::Date:
-            m_display.printAt(75, 2, m_fonts.medium, "Set date");
-            break;
-        case Edit::Time:
-            m_display.printAt(75, 2, m_fonts.medium, "Set time");
-            break;
+        case Edit::Date: m_display.fill(date); break;
+        case Edit::Time: m_display.fill(time); break;
     };
-    m_display.update();
+    update();
 }
 
 void Menu::nextMenu()
@@ -144,26 +151,35 @@ void Menu::runEditDate()
     };
     while (!done)
     {
+        m_buses.poll();
+        m_display.poll();
+        pollFrameRate();
         const auto e = m_keyboard.get();
         using Action = Keyboard::Action;
-        switch (e.action.value())
+        if (e.action)
         {
-            case Action::Enter:
-                if (part == DatePart::Day)
-                    done = true;
-                else
-                    part = next(part);
-                break;
-            case Action::Plus:  incPart(part, date); break;
-            case Action::Minus: decPart(part, date); break;
-            case Action::Exit:  return;
-        };
+            switch (*e.action)
+            {
+                case Action::Enter:
+                    if (part == DatePart::Day)
+                        done = true;
+                    else
+                        part = next(part);
+                    break;
+                case Action::Plus:  incPart(part, date); break;
+                case Action::Minus: decPart(part, date); break;
+                case Action::Exit:  return;
+            };
+            m_frameRate.invalidate();
+        }
         if (blink.expired())
         {
             showPart = !showPart;
             blink.reset();
+            m_frameRate.invalidate();
         }
-        showEditDate(date, part, showPart);
+        if (m_frameRate.due())
+            showEditDate(date, part, showPart);
     }
     RTC::Device::setDate(date);
 }
@@ -197,26 +213,35 @@ void Menu::runEditTime()
     };
     while (!done)
     {
+        m_buses.poll();
+        m_display.poll();
+        pollFrameRate();
         const auto e = m_keyboard.get();
         using Action = Keyboard::Action;
-        switch (e.action.value())
+        if (e.action)
         {
-            case Action::Enter:
-                if (part == TimePart::Second)
-                    done = true;
-                else
-                    part = next(part);
-                break;
-            case Action::Plus:  incPart(part, time); break;
-            case Action::Minus: decPart(part, time); break;
-            case Action::Exit:  return;
-        };
+            switch (*e.action)
+            {
+                case Action::Enter:
+                    if (part == TimePart::Second)
+                        done = true;
+                    else
+                        part = next(part);
+                    break;
+                case Action::Plus:  incPart(part, time); break;
+                case Action::Minus: decPart(part, time); break;
+                case Action::Exit:  return;
+            };
+            m_frameRate.invalidate();
+        }
         if (blink.expired())
         {
             showPart = !showPart;
             blink.reset();
+            m_frameRate.invalidate();
         }
-        showEditTime(time, part, showPart);
+        if (m_frameRate.due())
+            showEditTime(time, part, showPart);
     }
     RTC::Device::setTime(time);
 }
@@ -224,44 +249,52 @@ void Menu::runEditTime()
 void Menu::showEditDate(const Date& dt, DatePart part, bool showPart)
 {
     m_display.clear();
+    const auto text = toString(dt);
+    m_display.printAt(0, 0, m_fonts.big, text);
     if (!showPart)
-    {
-        std::string v;
-        if (part == DatePart::Year)
-            v += "    -";
-        else
-            v += std::to_string(dt.year) + "-";
-        if (part == DatePart::Month)
-            v += "  -";
-        else
-            v += lz(dt.month) + "-";
-        if (part != DatePart::Day)
-            v += lz(dt.day);
-        m_display.printAt(0, 0, m_fonts.big, v);
-    }
-    else
-        m_display.printAt(0, 0, m_fonts.big, toString(dt));
-    m_display.update();
+        blankField(text, '-', std::to_underlying(part));
+    update();
 }
 
 void Menu::showEditTime(const Time& tm, TimePart part, bool showPart)
 {
     m_display.clear();
+    const auto text = toString(tm, Time::Format::Full);
+    m_display.printAt(0, 0, m_fonts.big, text);
     if (!showPart)
+        blankField(text, ':', std::to_underlying(part));
+    update();
+}
+
+// The font is proportional, so the field is cleared where it was printed
+// and the rest of the text stays put
+void Menu::blankField(std::string_view text, char separator, size_t field)
+{
+    size_t first = 0;
+    for (size_t i = 0; i < field; ++i)
+        first = text.find(separator, first) + 1;
+    const auto last = std::min(text.find(separator, first), text.size());
+    const auto x = first == 0 ? 0 : m_fonts.big.textWidth(text.substr(0, first)) + 1;
+    const auto w = m_fonts.big.textWidth(text.substr(first, last - first));
+    m_display.bar(static_cast<int>(x), 0, static_cast<int>(w), static_cast<int>(m_fonts.big.height()), Display::Color::Black);
+}
+
+void Menu::update()
+{
+    if constexpr (SHOW_FRAME_RATE)
     {
-        std::string v;
-        if (part == TimePart::Hour)
-            v += "  :";
-        else
-            v += lz(tm.hour) + ":";
-        if (part == TimePart::Minute)
-            v += "  :";
-        else
-            v += lz(tm.minute) + ":";
-        if (part != TimePart::Second)
-            v += lz(tm.second);
+        m_frameStats.invalidate(); // Drawn over by the frame
+        m_frameStats.render(m_display);
     }
-    else
-        m_display.printAt(0, 0, m_fonts.big, toString(tm));
     m_display.update();
+    m_frameRate.frame(m_display.frameBytes());
+}
+
+void Menu::pollFrameRate()
+{
+    if (!m_frameRate.poll() || !SHOW_FRAME_RATE)
+        return;
+    m_frameStats.set(std::to_string(m_frameRate.fps()) + "fps " + std::to_string(m_frameRate.bytesPerSecond()) + "B/s");
+    if (m_frameStats.render(m_display))
+        m_display.update();
 }
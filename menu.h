@@ -1,9 +1,17 @@
 #pragma once
 
+#include "board.h" // Board::DisplayPanel
+#include "framerate.h"
+#include "fonts.h"
+#include "widgets.h"
+
+#include <string_view>
 #include <cstdint>
+#include <cstddef> // size_t
 
-class Display;
-struct Fonts;
+template <typename P, typename L>
+class BasicDisplay;
+using Display = BasicDisplay<Board::DisplayPanel, Board::DisplayLink>;
 class Keyboard;
 struct Date;
 struct Time;
@@ -11,17 +19,26 @@ struct Time;
 class Menu
 {
     public:
-        Menu(Display& d, Fonts& f, Keyboard& k);
+        // b - polled along with the display so a stuck bus recovers while in the menu
+        // maxFps - cap of the redraws while editing, they happen on input and blinks only
+        Menu(Board::BusSet& b, Display& d, Fonts& f, Keyboard& k, uint32_t maxFps = 20);
 
         void run();
     private:
+        // Debug: frames and bus bytes of the last second on the bottom line,
+        // both stay 0 while nothing changes. Its own redraws aren't counted.
+        static constexpr bool SHOW_FRAME_RATE = false;
+
         enum class Edit : uint8_t { Date = 0, Time = 1 };
         enum class DatePart : uint8_t { Year = 0, Month = 1, Day = 2 };
         enum class TimePart : uint8_t { Hour = 0, Minute = 1, Second = 2 };
         Edit m_edit = Edit::Date;
+        Board::BusSet& m_buses;
         Display& m_display;
         Fonts& m_fonts;
         Keyboard& m_keyboard;
+        FrameRate m_frameRate;
+        Widget::Text<20> m_frameStats{{0, 24, 128, 8}, Fonts::tiny};
 
         void show();
         void nextMenu();
@@ -31,4 +48,7 @@ class Menu
         void runEditTime();
         void showEditDate(const Date& dt, DatePart part, bool showPart);
         void showEditTime(const Time& tm, TimePart part, bool showPart);
+        void blankField(std::string_view text, char separator, size_t field);
+        void update();
+        void pollFrameRate();
 };
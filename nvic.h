@@ -0,0 +1,89 @@
+#pragma once
+
+#include <utility> // std::to_underlying
+#include <cstdint>
+
+namespace NVIC
+{
+
+struct Type
+{
+    volatile uint32_t ISER[8];      // Interrupt set-enable
+    volatile uint32_t RESERVED0[24];
+    volatile uint32_t ICER[8];      // Interrupt clear-enable
+    volatile uint32_t RESERVED1[24];
+    volatile uint32_t ISPR[8];      // Interrupt set-pending
+    volatile uint32_t RESERVED2[24];
+    volatile uint32_t ICPR[8];      // Interrupt clear-pending
+    volatile uint32_t RESERVED3[24];
+    volatile uint32_t IABR[8];      // Interrupt active bit
+    volatile uint32_t RESERVED4[56];
+    volatile uint8_t  IPR[240];     // Interrupt priority
+};
+
+inline Type* const Regs = reinterpret_cast<Type*>(0xE000E100);
+
+enum class IRQ : uint8_t
+{
+    DMA1_Stream0 = 11,
+    DMA1_Stream1 = 12,
+    DMA1_Stream2 = 13,
+    DMA1_Stream3 = 14,
+    DMA1_Stream4 = 15,
+    DMA1_Stream5 = 16,
+    DMA1_Stream6 = 17,
+    I2C1_EV      = 31,
+    I2C1_ER      = 32,
+    I2C2_EV      = 33,
+    I2C2_ER      = 34,
+    SPI1         = 35,
+    SPI2         = 36,
+    DMA1_Stream7 = 47,
+    DMA2_Stream3 = 59,
+    I2C3_EV      = 72,
+    I2C3_ER      = 73
+};
+
+inline
+void enable(IRQ irq)
+{
+    const auto n = std::to_underlying(irq);
+    Regs->ISER[n >> 5] = 1UL << (n & 0x1F);
+}
+
+inline
+void disable(IRQ irq)
+{
+    const auto n = std::to_underlying(irq);
+    Regs->ICER[n >> 5] = 1UL << (n & 0x1F);
+}
+
+// Only 4 upper bits are implemented on STM32F4
+inline
+void setPriority(IRQ irq, uint8_t priority)
+{
+    Regs->IPR[std::to_underlying(irq)] = static_cast<uint8_t>(priority << 4);
+}
+
+// Masks all configurable interrupts for the lifetime of the object
+class CriticalSection
+{
+    public:
+        CriticalSection()
+        {
+            asm volatile("mrs %0, primask\n"
+                         "cpsid i" : "=r"(m_primask) : : "memory");
+        }
+        ~CriticalSection()
+        {
+            asm volatile("msr primask, %0" : : "r"(m_primask) : "memory");
+        }
+
+        CriticalSection(const CriticalSection&) = delete;
+        CriticalSection& operator=(const CriticalSection&) = delete;
+
+    private:
+        uint32_t m_primask;
+};
+
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "framebuffer.h"
+
+#include <array>
+#include <cstdint>
+#include <cstddef> // size_t
+
+/*
+ * Display controller policies: geometry, init sequence and addressing.
+ *
+ * fullFrame  - the whole RAM can be sent as a single stream after fullWindow;
+ * window()   - command to place the data for columns [first, last] of a page;
+ * sleep      - panel off, then the charge pump, the RAM is kept;
+ * wake       - the reverse of sleep;
+ * hasScroll  - continuous scrolling by the controller, see scroll().
+ */
+
+namespace Panel
+{
+
+// Horizontal scrolling rotates the RAM of the pages, diagonal also moves the whole screen up
+enum class Scroll : uint8_t { Right, Left, DiagonalRight, DiagonalLeft };
+
+// Frames per step, the values are the interval codes of SSD1306
+enum class ScrollSpeed : uint8_t
+{
+    Frames2   = 0x07,
+    Frames3   = 0x04,
+    Frames4   = 0x05,
+    Frames5   = 0x00,
+    Frames25  = 0x06,
+    Frames64  = 0x01,
+    Frames128 = 0x02,
+    Frames256 = 0x03
+};
+
+/*
+ * Template parameters:
+ * W, H    - panel size in pixels;
+ * ComPins - COM pins hardware configuration (0xDA), depends on the panel wiring.
+ */
+template <size_t W, size_t H, uint8_t ComPins>
+struct SSD1306
+{
+    using FB = Framebuffer<W, H>;
+
+    static constexpr bool fullFrame = true; // Horizontal addressing mode
+    static constexpr uint8_t defaultContrast = 0x8F;
+
+    static constexpr std::array<uint8_t, 32> init = {
+        0xAE,                                             // Turn off
+        0xA8, static_cast<uint8_t>(H - 1),                // Multiplex ratio
+        0x20, 0x00,                                       // Memory mode, horizontal
+        0x21, 0x00, static_cast<uint8_t>(W - 1),          // Columns
+        0x22, 0x00, static_cast<uint8_t>(FB::pageCount - 1), // Pages
+        0x40,                                             // Start line
+        0xD3, 0x00,                                       // Offset
+        0xA0,                                             // Segment remap
+        0xC0,                                             // COM scan direction
+        0xDA, ComPins,                                    // COM pins config
+        0x81, defaultContrast,                            // Contrast
+        0xA4,                                             // Resume to RAM
+        0xA6,                                             // Normal display, 0xA7 - inverted
+        0xD5, 0x80,                                       // Display refresh freq
+        0xD9, 0xF1,                                       // Precharge period
+        0xDB, 0x20,                                       // VCOMH level
+        0x8D, 0x14,                                       // Charge pump on
+        0xAF                                              // Turn on
+    };
+
+    static constexpr std::array<uint8_t, 3> sleep = {0xAE, 0x8D, 0x10};
+    static constexpr std::array<uint8_t, 3> wake = {0x8D, 0x14, 0xAF};
+
+    static constexpr bool hasScroll = true;
+    static constexpr std::array<uint8_t, 1> stopScroll = {0x2E};
+    static constexpr std::array<uint8_t, 1> startScroll = {0x2F};
+
+    // Setup of pages [first, last], the whole screen is the vertical scroll area.
+    // Padded with NOPs, horizontal setup is shorter.
+    static constexpr std::array<uint8_t, 10> scroll(Scroll dir, uint8_t first, uint8_t last, ScrollSpeed speed, uint8_t verticalOffset)
+    {
+        const auto interval = static_cast<uint8_t>(speed);
+        switch (dir)
+        {
+            case Scroll::Right:
+                return {0x26, 0x00, first, interval, last, 0x00, 0xFF, 0xE3, 0xE3, 0xE3};
+            case Scroll::Left:
+                return {0x27, 0x00, first, interval, last, 0x00, 0xFF, 0xE3, 0xE3, 0xE3};
+            case Scroll::DiagonalRight:
+                return {0xA3, 0x00, static_cast<uint8_t>(H), 0x29, 0x00, first, interval, last, verticalOffset, 0xE3};
+            case Scroll::DiagonalLeft:
+                return {0xA3, 0x00, static_cast<uint8_t>(H), 0x2A, 0x00, first, interval, last, verticalOffset, 0xE3};
+        };
+        return {0xE3, 0xE3, 0xE3, 0xE3, 0xE3, 0xE3, 0xE3, 0xE3, 0xE3, 0xE3};
+    }
+
+    static constexpr std::array<uint8_t, 6> fullWindow = {
+        0x21, 0x00, static_cast<uint8_t>(W - 1),
+        0x22, 0x00, static_cast<uint8_t>(FB::pageCount - 1)
+    };
+
+    static constexpr std::array<uint8_t, 6> window(uint8_t page, uint8_t first, uint8_t last)
+    {
+        return {0x21, first, last, 0x22, page, page};
+    }
+};
+
+/*
+ * SH1106 has 132 columns of RAM with the panel in the middle and no
+ * horizontal addressing mode: data goes page by page.
+ */
+template <size_t W, size_t H, uint8_t ColumnOffset = 2>
+struct SH1106
+{
+    using FB = Framebuffer<W, H>;
+
+    static constexpr bool fullFrame = false;
+    static constexpr uint8_t defaultContrast = 0x8F;
+
+    static constexpr std::array<uint8_t, 25> init = {
+        0xAE,                              // Turn off
+        0xA8, static_cast<uint8_t>(H - 1), // Multiplex ratio
+        0x40,                              // Start line
+        0xD3, 0x00,                        // Offset
+        0xA0,                              // Segment remap
+        0xC0,                              // COM scan direction
+        0xDA, 0x12,                        // COM pins config
+        0x81, defaultContrast,             // Contrast
+        0xA4,                              // Resume to RAM
+        0xA6,                              // Normal display, 0xA7 - inverted
+        0xD5, 0x80,                        // Display refresh freq
+        0xD9, 0x22,                        // Precharge period
+        0xDB, 0x35,                        // VCOM deselect level
+        0xAD, 0x8B,                        // DC-DC on
+        0x32,                              // Pump voltage 8V
+        0xAF,                              // Turn on
+        0xE3                               // NOP
+    };
+
+    static constexpr std::array<uint8_t, 3> sleep = {0xAE, 0xAD, 0x8A}; // DC-DC off
+    static constexpr std::array<uint8_t, 3> wake = {0xAD, 0x8B, 0xAF};
+
+    static constexpr bool hasScroll = false;
+
+    static constexpr std::array<uint8_t, 3> window(uint8_t page, uint8_t first, uint8_t /*last*/)
+    {
+        const auto column = static_cast<uint8_t>(first + ColumnOffset);
+        return {static_cast<uint8_t>(0xB0 | page), static_cast<uint8_t>(column & 0x0F), static_cast<uint8_t>(0x10 | (column >> 4))};
+    }
+};
+
+using SSD1306_128x32 = SSD1306<128, 32, 0x02>;
+using SSD1306_128x64 = SSD1306<128, 64, 0x12>;
+using SH1106_128x64 = SH1106<128, 64>;
+
+}
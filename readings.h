@@ -0,0 +1,55 @@
+#pragma once
+
+#include "regmap.h"
+#include "byteorder.h"
+
+#include <cstddef> // offsetof
+#include <cstdint>
+
+/*
+ * Register map of the monitor as an I2C target, multi-byte values are big-endian.
+ *
+ * 0x00     ID, 'M'
+ * 0x01     Map version
+ * 0x02     Sequence number, incremented by each update
+ * 0x03     Status: bit 0 - BME280 data valid, bit 1 - INA219 data valid
+ * 0x04-07  Temperature, 0.01 C
+ * 0x08-0B  Pressure, Pa, Q24.8
+ * 0x0C-0F  Humidity, %RH, Q22.10
+ * 0x10-11  INA219 bus voltage register
+ * 0x12-13  INA219 shunt voltage register
+ * 0x14-15  INA219 current register
+ * 0x16-17  INA219 power register
+ * 0x18-19  Year
+ * 0x1A-1E  Month, day, hour, minute, second
+ */
+struct Readings
+{
+    static constexpr uint8_t BME280_VALID = 0x01;
+    static constexpr uint8_t INA219_VALID = 0x02;
+
+    uint8_t id = 'M';
+    uint8_t version = 1;
+    uint8_t sequence = 0;
+    uint8_t status = 0;
+    BE<int32_t> temperature;
+    BE<uint32_t> pressure;
+    BE<uint32_t> humidity;
+    BE<uint16_t> busVoltage;
+    BE<uint16_t> shuntVoltage;
+    BE<uint16_t> current;
+    BE<uint16_t> power;
+    BE<uint16_t> year;
+    uint8_t month = 0;
+    uint8_t day = 0;
+    uint8_t hour = 0;
+    uint8_t minute = 0;
+    uint8_t second = 0;
+};
+
+static_assert(offsetof(Readings, temperature) == 0x04, "Register map layout has changed");
+static_assert(offsetof(Readings, busVoltage) == 0x10, "Register map layout has changed");
+static_assert(offsetof(Readings, year) == 0x18, "Register map layout has changed");
+static_assert(sizeof(Readings) == 0x1F, "Register map layout has changed");
+
+using ReadingsMap = I2C::RegisterMap<Readings>;
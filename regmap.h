@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef> // size_t
+
+/*
+ * Read-only register map served in I2C target mode.
+ *
+ * Protocol: the controller writes the register number, then reads any number
+ * of bytes with a repeated START. The register pointer advances with each
+ * byte, bytes past the end read as 0xFF. Data written after the register
+ * number is ignored.
+ *
+ * Snapshot is a trivially copyable struct that is the map layout itself.
+ * The producer fills the back buffer and publishes it, the ISR reads the front
+ * buffer in place. The buffer is latched on the first ADDR of a bus
+ * transaction and kept until STOP, so multi-byte values are always consistent.
+ * Neither side blocks: while the ISR holds the back buffer the update is skipped.
+ */
+
+namespace I2C
+{
+
+template <typename Snapshot>
+class RegisterMap
+{
+    public:
+        static_assert(std::is_trivially_copyable_v<Snapshot>, "Snapshot must be trivially copyable");
+        static_assert(sizeof(Snapshot) <= 256, "Register numbers are 8-bit");
+
+        static constexpr size_t size = sizeof(Snapshot);
+
+        // Producer side. Returns nullptr if the ISR still reads the back buffer.
+        // The back buffer starts as a copy of the front one.
+        Snapshot* beginUpdate()
+        {
+            const auto back = 1 - m_front;
+            if (m_latched == back)
+                return nullptr;
+            m_buffers[back] = m_buffers[m_front];
+            return &m_buffers[back];
+        }
+
+        void publish() { m_front = static_cast<uint8_t>(1 - m_front); }
+
+        const Snapshot& current() const { return m_buffers[m_front]; }
+
+        // Target side, called from the ISR
+        void onAddress(bool read)
+        {
+            if (m_latched < 0)
+                m_latched = static_cast<int8_t>(m_front);
+            m_expectReg = !read;
+        }
+
+        void onWrite(uint8_t b)
+        {
+            if (!m_expectReg)
+                return;
+            m_pointer = b;
+            m_expectReg = false;
+        }
+
+        uint8_t onRead()
+        {
+            if (m_latched < 0 || m_pointer >= size)
+                return 0xFF;
+            const auto* bytes = reinterpret_cast<const uint8_t*>(&m_buffers[static_cast<size_t>(m_latched)]);
+            return bytes[m_pointer++];
+        }
+
+        void onStop()
+        {
+            m_latched = -1;
+            m_expectReg = false;
+        }
+
+    private:
+        std::array<Snapshot, 2> m_buffers{};
+        volatile uint8_t m_front = 0;
+        volatile int8_t m_latched = -1; // Buffer used by the current bus transaction
+        size_t m_pointer = 0;
+        bool m_expectReg = false;
+};
+
+}
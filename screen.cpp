@@ -2,13 +2,25 @@
 
 #include "menu.h"
 #include "clocks.h"
+#include "dwt.h"
 
 namespace
 {
 
-std::string formatTemp(int32_t v)
+std::string formatHex(uint8_t v)
 {
-    return std::to_string(v / 10) + "." + std::to_string(v % 10);
+    constexpr char digits[] = "0123456789ABCDEF";
+    return {digits[v >> 4], digits[v & 0x0F]};
+}
+
+// Address, finished transactions, failed attempts, bus time
+std::string formatDevice(const I2C::DeviceStats& s)
+{
+    constexpr auto cyclesPerMs = static_cast<uint64_t>(Board::SysClock::AHBFreq * 1000);
+    return formatHex(s.address) +
+           " t" + std::to_string(s.transactions) +
+           " f" + std::to_string(s.nacks + s.timeouts + s.errors) +
+           " " + std::to_string(s.busyCycles / cyclesPerMs) + "ms";
 }
 
 struct BME280Data
@@ -18,10 +30,12 @@ struct BME280Data
     int32_t t;
 };
 
-bool readBME280(BME280& sensor, BME280Data& data)
+// Raw values go to the register map, scaled ones to the screen
+bool readBME280(BME280& sensor, BME280Data& raw, BME280Data& data)
 {
-    if (!sensor.readData(data.h, data.p, data.t))
+    if (!sensor.readData(raw.h, raw.p, raw.t))
         return false;
+    data = raw;
     data.h /= 1024;
     data.p /= 25600;
     data.t /= 10;
@@ -33,121 +47,246 @@ bool readBME280(BME280& sensor, BME280Data& data)
 
 }
 
-Screen::Screen(double pFreq)
-    : m_port(pFreq, 100000),
-      m_display(m_port, 0x3C),
-      m_sensor(m_port, 0x76),
+Screen::Screen()
+    : m_display(m_buses.display()),
+      m_saver(m_display),
+      m_sensor(m_buses.sensor(), 0x76),
+      m_power(m_buses.sensor(), 0x40),
       m_timer(std::chrono::seconds(1))
 {
     m_display.init();
     m_sensor.init();
+    m_power.init();
+    m_buses.sensor().setTarget(Board::TARGET_ADDRESS, m_readings);
 }
 
 void Screen::run()
 {
-    HPT hpt;
-    DateTime dt;
+    show();
     while (true)
     {
+        m_buses.poll();
+        m_display.poll();
+        m_saver.poll();
         const auto e = m_keyboard.get();
+        // The key that wakes the panel does nothing else
+        if (e.action && m_saver.activity())
+            continue;
         using Action = Keyboard::Action;
-        switch (e.action.value())
+        // Idle passes go on to the timer below
+        if (e.action)
         {
-            case Action::Enter: runMenu(); break;
-            case Action::Plus:  nextView(); show(hpt, dt); break;
-            case Action::Minus: prevView(); show(hpt, dt); break;
-            case Action::Exit: break;
-        };
+            switch (*e.action)
+            {
+                case Action::Enter: runMenu(); m_saver.activity(); break;
+                case Action::Plus:  nextView(); show(); break;
+                case Action::Minus: prevView(); show(); break;
+                case Action::Exit:  m_showTrend = !m_showTrend; show(); break;
+            };
+        }
 
         if (m_timer.expired())
         {
             m_timer.reset();
+            BME280Data raw;
             BME280Data bmeData;
-            if (!readBME280(m_sensor, bmeData))
+            const auto valid = readBME280(m_sensor, raw, bmeData);
+            const auto now = RTC::Device::get();
+            const HPT rawHPT = {raw.h, raw.p, raw.t};
+            Power power;
+            const auto powerValid = m_power.readData(power.bus, power.shunt, power.current, power.power);
+            publish(valid ? &rawHPT : nullptr, powerValid ? &power : nullptr, now);
+            if (!valid)
                 showBME280Failure();
             else
             {
-                hpt = {bmeData.h, bmeData.p, bmeData.t};
-                dt = RTC::Device::get();
-                show(hpt, dt);
+                m_hpt = {bmeData.h, bmeData.p, bmeData.t};
+                m_tempTrend.push(m_hpt.t);
+                m_pressTrend.push(static_cast<int32_t>(m_hpt.p));
+                m_humTrend.push(static_cast<int32_t>(m_hpt.h));
+                m_time.set(toString(now.time));
+                m_date.set(toString(now.date));
+                updateBus();
+                if (m_redraw)
+                    show();
+                else
+                    render();
             }
         }
     }
 }
 
+// Skipped if the controller is still reading the back buffer, the next second will do
+void Screen::publish(const HPT* raw, const Power* power, const DateTime& dt)
+{
+    auto* r = m_readings.beginUpdate();
+    if (r == nullptr)
+        return;
+    ++r->sequence;
+    if (raw != nullptr)
+    {
+        r->status |= Readings::BME280_VALID;
+        r->temperature = raw->t;
+        r->pressure = raw->p;
+        r->humidity = raw->h;
+    }
+    else
+        r->status &= static_cast<uint8_t>(~Readings::BME280_VALID);
+    if (power != nullptr)
+    {
+        r->status |= Readings::INA219_VALID;
+        r->busVoltage = power->bus;
+        r->shuntVoltage = power->shunt;
+        r->current = power->current;
+        r->power = power->power;
+    }
+    else
+        r->status &= static_cast<uint8_t>(~Readings::INA219_VALID);
+    r->year = dt.year();
+    r->month = dt.month();
+    r->day = dt.day();
+    r->hour = dt.hour();
+    r->minute = dt.minute();
+    r->second = dt.second();
+    m_readings.publish();
+}
+
+// Frames are held back while the alarm scrolls, so it's stopped for the menu
+// and restarted after it if the sensor is still failing
 void Screen::runMenu()
 {
-    Menu menu(m_display, m_fonts, m_keyboard);
+    const auto failure = m_redraw;
+    m_alarm.stop(m_display);
+    Menu menu(m_buses, m_display, m_fonts, m_keyboard);
     menu.run();
+    if (!failure)
+        return show();
+    m_redraw = false;
+    showBME280Failure();
 }
 
 void Screen::nextView()
 {
-    m_view = static_cast<View>((std::to_underlying(m_view) + 1) % 4);
+    m_view = static_cast<View>((std::to_underlying(m_view) + 1) % 5);
 }
 
 void Screen::prevView()
 {
     if (m_view == View::DateTime)
-        m_view = View::Hum;
+        m_view = View::Bus;
     else
         m_view = static_cast<View>(std::to_underlying(m_view) - 1);
 }
 
-void Screen::show(const HPT& hpt, const DateTime& dt)
+// Widgets of the current view, the summary is on all but the bus one
+template <typename F>
+void Screen::visit(F f)
 {
-    m_display.clear();
-    showCommon(hpt);
+    if (m_view == View::Bus)
+    {
+        for (auto& line : m_busLines)
+            f(line);
+        return;
+    }
+    f(m_sideTemp);
+    f(m_sidePress);
+    f(m_sideHum);
+    if (const auto* t = trend(); t != nullptr)
+    {
+        m_trend.bind(*t);
+        f(m_trend);
+        return;
+    }
     switch (m_view)
     {
-        case View::DateTime: showDT(dt); break;
-        case View::Temp:     showTemp(hpt.t); break;
-        case View::Press:    showPress(hpt.p); break;
-        case View::Hum:      showHum(hpt.h); break;
+        case View::DateTime: f(m_time); f(m_date); break;
+        case View::Temp:     f(m_temp); break;
+        case View::Press:    f(m_press); break;
+        case View::Hum:      f(m_hum); break;
+        case View::Bus:      break;
     };
-    m_display.update();
 }
 
-void Screen::showDT(const DateTime& dt)
+// The whole screen, after the view changed or something else drew on it
+void Screen::show()
 {
-    m_display.printAt(0, 0, m_fonts.big, toString(dt.time));
-    m_display.printAt(0, 22, m_fonts.tiny, toString(dt.date));
+    static_assert(Fonts::big.contains("C mm%"), "Glyphs missing in Charset::values");
+    static_assert(VALUE_X - static_cast<int>(Fonts::tiny.textWidth("1000")) > DIVIDER_X, "Values overlap the divider");
+    m_redraw = false;
+    m_alarm.stop(m_display);
+    m_display.fill(background());
+    visit([](auto& w){ w.invalidate(); });
+    render();
 }
 
-void Screen::showTemp(int32_t t)
+// Only the widgets whose values changed, no update if none did.
+// The bytes are of the last flush, the controller may still be busy with the previous frame.
+bool Screen::render()
 {
-    m_display.printAt(0, 0, m_fonts.big, formatTemp(t));
-    m_display.printAt(50, 0, m_fonts.big, "C");
+    const auto start = DWT::cycles();
+    size_t drawn = 0;
+    visit([&](auto& w){ drawn += w.render(m_display); });
+    m_stats.cycles = DWT::cycles() - start;
+    m_stats.widgets = drawn;
+    if (drawn == 0)
+        return false;
+    m_display.update();
+    m_stats.bytes = m_display.frameBytes();
+    return true;
 }
 
-void Screen::showPress(uint32_t p)
+// Rasterized at compile time, the widgets draw on top
+const Display::Pages& Screen::background() const
 {
-    m_display.printAt(0, 0, m_fonts.big, std::to_string(p));
-    m_display.printAt(40, 0, m_fonts.big, "mm");
+    using L = Layer<Display::width, Display::height>;
+    static constexpr Display::Pages blank{};
+    static constexpr auto summary = L()
+        .text(UNIT_X, 2,  Fonts::tiny, "C")
+        .text(UNIT_X, 12, Fonts::tiny, "mmhg")
+        .text(UNIT_X, 22, Fonts::tiny, "%")
+        .vline(DIVIDER_X, 0, Display::height)
+        .pages();
+    return m_view == View::Bus ? blank : summary;
 }
 
-void Screen::showHum(uint32_t h)
+// Null if the view has no graph or graphs are off
+const Screen::Trend* Screen::trend() const
 {
-    m_display.printAt(0, 0, m_fonts.big, std::to_string(h));
-    m_display.printAt(40, 0, m_fonts.big, "%");
+    if (!m_showTrend)
+        return nullptr;
+    switch (m_view)
+    {
+        case View::Temp:     return &m_tempTrend;
+        case View::Press:    return &m_pressTrend;
+        case View::Hum:      return &m_humTrend;
+        case View::DateTime: return nullptr;
+        case View::Bus:      return nullptr;
+    };
+    return nullptr;
 }
 
-void Screen::showCommon(const HPT& hpt)
+// Drawn once, the alarm line scrolls till the next show()
+void Screen::showBME280Failure()
 {
-    m_display.printAt(75, 2,  m_fonts.tiny, formatTemp(hpt.t));
-    m_display.printAt(75, 12, m_fonts.tiny, std::to_string(hpt.p));
-    m_display.printAt(75, 22, m_fonts.tiny, std::to_string(hpt.h));
-    m_display.printAt(107, 2,  m_fonts.tiny, "C");
-    m_display.printAt(100, 12, m_fonts.tiny, "mmhg");
-    m_display.printAt(107, 22, m_fonts.tiny, "%");
-
-    m_display.vline(71, 0, 32, Display::Color::White);
+    static_assert(Fonts::tiny.textWidth(ALARM) <= Display::width, "The alarm doesn't fit the scrolled page");
+    static constexpr auto failure = Layer<Display::width, Display::height>()
+        .text(75, 2,  Fonts::tiny, "BME280")
+        .text(75, 12, Fonts::tiny, "failure")
+        .pages();
+    if (m_redraw) // Already shown
+        return;
+    m_redraw = true;
+    m_display.fill(failure);
+    m_alarm.render(m_display);
 }
 
-void Screen::showBME280Failure()
+// Diagnostics of the sensor bus: utilization, render stats and up to 3 devices
+void Screen::updateBus()
 {
-    m_display.clear();
-    m_display.printAt(75, 2,  m_fonts.tiny, "BME280");
-    m_display.printAt(75, 12, m_fonts.tiny, "failure");
-    m_display.update();
+    using Bus = Board::SensorBus;
+    const auto stats = m_buses.sensor().busStats();
+    m_busLines[0].set("I2C" + std::to_string(Bus::num) + " " + std::to_string(stats.utilization) + "%" +
+                      " r" + std::to_string(m_stats.cycles) + " " + std::to_string(m_stats.bytes) + "B");
+    for (size_t i = 0; i < 3; ++i)
+        m_busLines[i + 1].set(i < stats.devices ? formatDevice(stats.perDevice[i]) : std::string());
 }
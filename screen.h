@@ -1,24 +1,34 @@
 #pragma once
 
+#include "board.h"
 #include "display.h"
 #include "keyboard.h"
 #include "bme280.h"
+#include "ina219.h"
 #include "i2c.h"
 #include "fonts.h"
 #include "rtc.h"
 #include "datetime.h"
+#include "readings.h"
 #include "timer.h"
+#include "graph.h"
+#include "screensaver.h"
+#include "widgets.h"
+#include "layer.h"
 
+#include <array>
+#include <string>
+#include <string_view>
 #include <cstdint>
 
 class Screen
 {
     public:
-        Screen(double pFreq);
+        Screen();
         void run();
 
     private:
-        enum class View : uint8_t { DateTime = 0, Temp = 1, Press = 2, Hum = 3 };
+        enum class View : uint8_t { DateTime = 0, Temp = 1, Press = 2, Hum = 3, Bus = 4 };
 
         struct HPT
         {
@@ -27,24 +37,87 @@ class Screen
             int32_t t  = 0;
         };
 
-        using I2C1 = I2C::Port<1>;
+        // INA219 registers, published as read
+        struct Power
+        {
+            uint16_t bus = 0;
+            uint16_t shunt = 0;
+            uint16_t current = 0;
+            uint16_t power = 0;
+        };
+
+        // What the last render() took and sent, shown on the bus view
+        struct FrameStats
+        {
+            uint32_t cycles = 0;
+            size_t widgets = 0;
+            size_t bytes = 0;
+        };
+
+        static constexpr int DIVIDER_X = 71;
+        static constexpr size_t UNIT_SPACE = 3;
+        // Units are left aligned to the right edge of the longest one, values end a space before
+        static constexpr int UNIT_X = static_cast<int>(Display::width - Fonts::tiny.textWidth("mmhg"));
+        static constexpr int VALUE_X = static_cast<int>(UNIT_X - UNIT_SPACE);
+        static constexpr Gfx::Rect MAIN_BOX = {0, 0, DIVIDER_X, static_cast<int>(Fonts::big.height())};
+
+        // Last minute of samples, fits left of the divider
+        using Trend = Graph<56, 32>;
+        using Line = Widget::Text<22>; // Full width of the tiny font
 
         View m_view = View::DateTime;
-        I2C1 m_port;
+        bool m_showTrend = false; // Graphs instead of the values, toggled by Exit
+        bool m_redraw = false;    // The screen isn't what the widgets drew, e.g. the failure one
+        HPT m_hpt;
+        FrameStats m_stats;
+        Trend m_tempTrend;
+        Trend m_pressTrend;
+        Trend m_humTrend;
+
+        // Summary right of the divider, the units and the divider are in the background layer
+        Widget::Number<int32_t> m_sideTemp{{DIVIDER_X + 1, 2, VALUE_X - DIVIDER_X - 1, 8}, Fonts::tiny, m_hpt.t, 1};
+        Widget::Number<uint32_t> m_sidePress{{DIVIDER_X + 1, 12, VALUE_X - DIVIDER_X - 1, 8}, Fonts::tiny, m_hpt.p};
+        Widget::Number<uint32_t> m_sideHum{{DIVIDER_X + 1, 22, VALUE_X - DIVIDER_X - 1, 8}, Fonts::tiny, m_hpt.h};
+
+        // Left of the divider, one of them per view
+        Widget::Text<8> m_time{MAIN_BOX, Fonts::big};
+        Widget::Text<10> m_date{{0, 22, DIVIDER_X, 8}, Fonts::tiny};
+        Widget::Number<int32_t> m_temp{MAIN_BOX, Fonts::big, m_hpt.t, 1, "C", Widget::Align::Left, UNIT_SPACE};
+        Widget::Number<uint32_t> m_press{MAIN_BOX, Fonts::big, m_hpt.p, 0, "mm", Widget::Align::Left, UNIT_SPACE};
+        Widget::Number<uint32_t> m_hum{MAIN_BOX, Fonts::big, m_hpt.h, 0, "%", Widget::Align::Left, UNIT_SPACE};
+        Widget::GraphView<Trend> m_trend{0, 0, m_tempTrend};
+
+        // Scrolled by the controller under the failure message
+        static constexpr std::string_view ALARM = "Check the sensor wiring";
+        Widget::Ticker m_alarm{3, 3, Display::width, Fonts::tiny, ALARM};
+
+        std::array<Line, 4> m_busLines{
+            Line{{0, 0, Display::width, 8}, Fonts::tiny},
+            Line{{0, 8, Display::width, 8}, Fonts::tiny},
+            Line{{0, 16, Display::width, 8}, Fonts::tiny},
+            Line{{0, 24, Display::width, 8}, Fonts::tiny}
+        };
+
+        Board::BusSet m_buses;
+        ReadingsMap m_readings;
         Display m_display;
+        ScreenSaver<Display> m_saver;
         Fonts m_fonts;
         Keyboard m_keyboard;
         BME280 m_sensor;
+        INA219 m_power;
         Timer m_timer;
 
         void runMenu();
-        void show(const HPT& hpt, const DateTime& dt);
-        void showDT(const DateTime& dt);
-        void showTemp(int32_t t);
-        void showPress(uint32_t p);
-        void showHum(uint32_t h);
-        void showCommon(const HPT& hpt);
+        void show();
+        const Display::Pages& background() const;
+        bool render();
+        template <typename F>
+        void visit(F f);
+        const Trend* trend() const;
+        void updateBus();
         void showBME280Failure();
+        void publish(const HPT* raw, const Power* power, const DateTime& dt);
 
         void prevView();
         void nextView();
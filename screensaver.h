@@ -0,0 +1,81 @@
+#pragma once
+
+#include "timer.h"
+
+#include <chrono>
+#include <cstdint>
+
+/*
+ * Inactivity policy of a display: fades to a dim contrast after dimAfter
+ * without input and puts the panel to sleep after offAfter, both counted
+ * from the last input. Input restores the full contrast at once.
+ *
+ * Template parameters:
+ * D - BasicDisplay.
+ */
+template <typename D>
+class ScreenSaver
+{
+    public:
+        struct Config
+        {
+            std::chrono::seconds dimAfter{30};
+            std::chrono::seconds offAfter{120};
+            uint8_t dimContrast = 0x08;
+            std::chrono::milliseconds fade{500};
+        };
+
+        explicit ScreenSaver(D& display, const Config& config = {})
+            : m_display(display),
+              m_config(config),
+              m_contrast(display.contrast()),
+              m_dimTimer(config.dimAfter),
+              m_offTimer(config.offAfter)
+        {
+        }
+
+        // Call on every input. True if the panel was dimmed or off,
+        // then the input only wakes it and should be dropped.
+        bool activity()
+        {
+            m_dimTimer.reset();
+            m_offTimer.reset();
+            const auto state = m_state;
+            m_state = State::Active;
+            switch (state)
+            {
+                case State::Active: return false;
+                case State::Dimmed: m_display.setContrast(m_contrast); return true;
+                case State::Off:
+                    m_display.setContrast(m_contrast);
+                    m_display.wake();
+                    return true;
+            };
+            return false;
+        }
+
+        void poll()
+        {
+            if (m_state == State::Active && m_dimTimer.expired())
+            {
+                m_contrast = m_display.contrast();
+                m_display.fadeTo(m_config.dimContrast, m_config.fade);
+                m_state = State::Dimmed;
+            }
+            else if (m_state == State::Dimmed && m_offTimer.expired())
+            {
+                m_display.sleep();
+                m_state = State::Off;
+            }
+        }
+
+    private:
+        enum class State : uint8_t { Active, Dimmed, Off };
+
+        D& m_display;
+        Config m_config;
+        uint8_t m_contrast; // Restored on input
+        State m_state = State::Active;
+        Timer m_dimTimer;
+        Timer m_offTimer;
+};
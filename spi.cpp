@@ -0,0 +1,119 @@
+#include "spi.h"
+
+#include "nvic.h"
+#include "dma.h"
+
+using PortBase = SPI::PortBase;
+
+namespace
+{
+
+constexpr auto CR1_MSTR     = BIT(2);
+constexpr auto CR1_SPE      = BIT(6);
+constexpr auto CR1_SSI      = BIT(8);
+constexpr auto CR1_SSM      = BIT(9);
+constexpr auto CR1_BIDIOE   = BIT(14);
+constexpr auto CR1_BIDIMODE = BIT(15);
+
+constexpr auto CR2_TXDMAEN = BIT(1);
+
+constexpr auto SR_TXE = BIT(1);
+constexpr auto SR_BSY = BIT(7);
+
+// TX requests, RM0368 tables 27 and 28. I2C3 TX takes DMA1 stream 4 as well.
+struct DMAStream
+{
+    DMA::Stream tx;
+    NVIC::IRQ irq;
+};
+
+DMAStream dmaStreams[2] = {
+    {{DMA::DMA2, 3, 3}, NVIC::IRQ::DMA2_Stream3}, // SPI1
+    {{DMA::DMA1, 4, 0}, NVIC::IRQ::DMA1_Stream4}  // SPI2
+};
+
+PortBase* ports[2] = {};
+
+}
+
+// One output line (BIDIMODE/BIDIOE), nothing is received, so no overruns either.
+// NSS is managed by software, the device select is up to the driver.
+void PortBase::init()
+{
+    clearBit(&m_regs->CR1, CR1_SPE);
+    m_regs->CR1 = CR1_MSTR | (static_cast<uint32_t>(m_baudRate) << 3) | CR1_SSM | CR1_SSI | CR1_BIDIMODE | CR1_BIDIOE;
+    m_regs->CR2 = 0;
+    setBit(&m_regs->CR1, CR1_SPE);
+
+    ports[m_num - 1] = this;
+    auto& dma = dmaStreams[m_num - 1];
+    DMA::enable(m_num == 1 ? DMA::DMA2 : DMA::DMA1);
+    NVIC::enable(dma.irq);
+}
+
+bool PortBase::write(const void* data, size_t size)
+{
+    wait();
+    const auto* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (!waitBitOn(&m_regs->SR, SR_TXE))
+            return false;
+        m_regs->DR = p[i];
+    }
+    waitIdle();
+    return true;
+}
+
+bool PortBase::writeAsync(const void* data, size_t size, Callback cb, void* context)
+{
+    if (m_busy || size == 0)
+        return false;
+    m_busy = true;
+    m_callback = cb;
+    m_context = context;
+    setBit(&m_regs->CR2, CR2_TXDMAEN);
+    dmaStreams[m_num - 1].tx.toPeriph(&m_regs->DR, data, size, true);
+    return true;
+}
+
+void PortBase::wait() const
+{
+    while (m_busy)
+        asm("nop");
+}
+
+// The last byte is still being shifted out when DMA is done
+void PortBase::waitIdle() const
+{
+    waitBitOn(&m_regs->SR, SR_TXE);
+    waitBitOff(&m_regs->SR, SR_BSY);
+}
+
+void PortBase::onDMA()
+{
+    auto& stream = dmaStreams[m_num - 1].tx;
+    const auto flags = stream.flags();
+    stream.clearFlags();
+    if ((flags & (DMA::FLAG_TC | DMA::FLAG_TE)) == 0)
+        return;
+    clearBit(&m_regs->CR2, CR2_TXDMAEN);
+    waitIdle();
+    m_busy = false;
+    if (m_callback != nullptr)
+        m_callback(m_context, (flags & DMA::FLAG_TE) == 0);
+}
+
+extern "C"
+void DMA2_Stream3_IRQHandler(void)
+{
+    if (ports[0] != nullptr)
+        ports[0]->onDMA();
+}
+
+extern "C"
+void DMA1_Stream4_IRQHandler(void)
+{
+    if (ports[1] != nullptr)
+        ports[1]->onDMA();
+}
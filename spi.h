@@ -0,0 +1,172 @@
+#pragma once
+
+#include "gpio.h"
+#include "rcc.h"
+#include "utils.h"
+
+#include <array>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef> // size_t
+
+namespace SPI
+{
+
+struct Regs
+{
+    volatile uint32_t CR1;     // Control 1
+    volatile uint32_t CR2;     // Control 2
+    volatile uint32_t SR;      // Status
+    volatile uint32_t DR;      // Data
+    volatile uint32_t CRCPR;   // CRC polynomial
+    volatile uint32_t RXCRCR;  // RX CRC
+    volatile uint32_t TXCRCR;  // TX CRC
+    volatile uint32_t I2SCFGR; // I2S configuration
+    volatile uint32_t I2SPR;   // I2S prescaler
+};
+
+inline
+constexpr Regs* getRegs(uint8_t num)
+{
+    return reinterpret_cast<Regs*>(num == 1 ? 0x40013000 : 0x40003800);
+}
+
+template <size_t Num>
+struct Pins
+{
+};
+
+template <>
+struct Pins<1>
+{
+    using SCK  = GPIO::Pin<'A', 5>;
+    using MOSI = GPIO::Pin<'A', 7>;
+    constexpr static uint8_t AF = 5;
+};
+
+template <>
+struct Pins<2>
+{
+    using SCK  = GPIO::Pin<'B', 13>;
+    using MOSI = GPIO::Pin<'B', 15>;
+    constexpr static uint8_t AF = 5;
+};
+
+// BR field: the smallest divider (2 to 256) that keeps SCK within maxMHz
+constexpr uint8_t baudRate(double pclkMHz, double maxMHz)
+{
+    uint8_t br = 0;
+    while (br < 7 && pclkMHz / (2 << br) > maxMHz)
+        ++br;
+    return br;
+}
+
+/*
+ * Transmit-only master, mode 0, MSB first: SCK and MOSI, no MISO.
+ * Short writes are polled, long ones go through DMA with the callback
+ * called from the ISR once the last bit is out.
+ */
+class PortBase
+{
+    public:
+        using Callback = void (*)(void* context, bool ok);
+
+        PortBase(uint8_t num, uint8_t baudRate)
+            : m_regs(getRegs(num)),
+              m_num(num),
+              m_baudRate(baudRate)
+        {
+        }
+
+        // The port is the bus, devices share it by reference
+        PortBase(const PortBase&) = delete;
+        PortBase& operator=(const PortBase&) = delete;
+
+        void init();
+
+        // Blocking
+        bool write(const void* data, size_t size);
+        // Non-blocking, the data must stay valid until the callback. False if busy.
+        bool writeAsync(const void* data, size_t size, Callback cb, void* context);
+        bool isBusy() const { return m_busy; }
+        void wait() const;
+        // Nothing times out, for the symmetry with I2C ports
+        void poll() {}
+
+        void onDMA();
+
+    private:
+        Regs* m_regs;
+        uint8_t m_num;
+        uint8_t m_baudRate;
+        volatile bool m_busy = false;
+        Callback m_callback = nullptr;
+        void* m_context = nullptr;
+
+        void waitIdle() const;
+};
+
+/*
+ * Template parameters:
+ * Num    - peripheral number, 1 (APB2) or 2 (APB1);
+ * Clock  - Clocks::SysClock the APB clock is taken from;
+ * MaxMHz - SCK limit, SSD1306 takes up to 10 MHz by the datasheet, most modules run at 21;
+ * PinsT  - SCK/MOSI pins and their AF number, for alternative pin mappings.
+ */
+template <uint8_t Num, typename Clock, double MaxMHz = 21.0, typename PinsT = Pins<Num>>
+class Port : public PortBase
+{
+    public:
+        static_assert(Num == 1 || Num == 2, "SPI1 or SPI2 only");
+
+        static constexpr auto num = Num;
+
+        using PinsDef = PinsT;
+        using SCK = PinsDef::SCK;
+        using MOSI = PinsDef::MOSI;
+        static constexpr std::array<uint16_t, 2> pins = {SCK::code, MOSI::code};
+
+        static constexpr double pclk = Num == 1 ? Clock::APB2Freq : Clock::APB1Freq;
+        static constexpr uint8_t br = baudRate(pclk, MaxMHz);
+        // SCK, MHz
+        static constexpr double freq = pclk / (2 << br);
+        static_assert(freq <= MaxMHz, "SCK can't be brought down to MaxMHz");
+
+        Port()
+            : PortBase(num, br)
+        {
+            SCK::enable();
+            MOSI::enable();
+            if constexpr (Num == 1)
+                setBit(&RCC::Regs->APB2ENR, BIT(12));
+            else
+                setBit(&RCC::Regs->APB1ENR, BIT(14));
+
+            configure<SCK>();
+            configure<MOSI>();
+
+            init();
+        }
+
+    private:
+        template <typename Pin>
+        static void configure()
+        {
+            Pin::setMode(GPIO::Mode::AF);
+            Pin::setAF(PinsDef::AF);
+            Pin::setOutputType(GPIO::OutputType::PUSH_PULL);
+            Pin::setPull(GPIO::Pull::NO);
+            Pin::setSpeed(GPIO::Speed::VERY_HIGH);
+        }
+};
+
+template <typename T>
+struct isPort : std::false_type {};
+
+template <uint8_t Num, typename Clock, double MaxMHz, typename PinsT>
+struct isPort<Port<Num, Clock, MaxMHz, PinsT>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool isPort_v = isPort<T>::value;
+
+}
@@ -0,0 +1,135 @@
+#include "gfx.h"
+
+#include <string>
+#include <cstdlib> // std::abs
+#include <iostream>
+
+int fail(const std::string& message)
+{
+    std::cout << message << "\n";
+    return -1;
+}
+
+using Pages = Gfx::Pages<16, 2>;
+
+bool pixel(const Pages& pages, int x, int y)
+{
+    return (pages[static_cast<size_t>(y / 8)][static_cast<size_t>(x)] >> (y % 8)) & 1;
+}
+
+size_t count(const Pages& pages)
+{
+    size_t res = 0;
+    for (int y = 0; y < 16; ++y)
+        for (int x = 0; x < 16; ++x)
+            res += pixel(pages, x, y);
+    return res;
+}
+
+// Plain Bresenham over the whole line, what Gfx::line must match after clipping
+void lineSteps(Pages& pages, int x0, int y0, int x1, int y1)
+{
+    const auto dx = std::abs(x1 - x0);
+    const auto dy = -std::abs(y1 - y0);
+    const auto sx = x0 < x1 ? 1 : -1;
+    const auto sy = y0 < y1 ? 1 : -1;
+    auto err = dx + dy;
+    while (true)
+    {
+        Gfx::plot(pages, x0, y0, 0xFF, Gfx::Rop::Xor);
+        if (x0 == x1 && y0 == y1)
+            break;
+        const auto e2 = 2 * err;
+        if (e2 >= dy)
+        {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+int main()
+{
+    using Gfx::Rop;
+
+    static_assert(Gfx::apply(0b1010, 0xFF, 0b0110, Rop::Copy) == 0b1110);
+    static_assert(Gfx::apply(0b1010, 0x00, 0b0110, Rop::Copy) == 0b1000);
+    static_assert(Gfx::apply(0b1010, 0x00, 0b0110, Rop::And) == 0b1000);
+    static_assert(Gfx::apply(0b1010, 0xFF, 0b0110, Rop::Xor) == 0b1100);
+    static_assert(Gfx::pageOf(-1) == -1 && Gfx::pageOf(-8) == -1 && Gfx::pageOf(-9) == -2 && Gfx::pageOf(8) == 1);
+
+    Pages pages{};
+
+    // Clipped on every side
+    auto r = Gfx::fillRect(pages, {-3, -2, 40, 40}, 0xFF, Rop::Copy);
+    if (r.x != 0 || r.y != 0 || r.w != 16 || r.h != 16 || count(pages) != 256)
+        return fail("Full screen fill is not clipped.");
+    if (!Gfx::fillRect(pages, {16, 0, 4, 4}, 0x00, Rop::Copy).empty())
+        return fail("Fill off the screen touches it.");
+
+    // Crosses the page boundary
+    pages = {};
+    Gfx::fillRect(pages, {2, 5, 3, 6}, 0xFF, Rop::Or);
+    if (count(pages) != 18 || !pixel(pages, 2, 5) || !pixel(pages, 4, 10) || pixel(pages, 4, 11) || pixel(pages, 5, 5))
+        return fail("Wrong masked fill.");
+    Gfx::fillRect(pages, {0, 0, 16, 16}, 0xFF, Rop::Xor);
+    if (count(pages) != 256 - 18 || pixel(pages, 3, 7))
+        return fail("Xor doesn't invert.");
+
+    // Bresenham: each pixel once, so Xor twice restores the screen
+    pages = {};
+    Gfx::line(pages, -5, -5, 20, 20, 0xFF, Rop::Xor);
+    if (count(pages) != 16 || !pixel(pages, 0, 0) || !pixel(pages, 15, 15))
+        return fail("Wrong clipped diagonal.");
+    Gfx::line(pages, -5, -5, 20, 20, 0xFF, Rop::Xor);
+    if (count(pages) != 0)
+        return fail("Line pixels are drawn twice.");
+
+    // Skipping the off-screen parts doesn't move a pixel, in any direction
+    for (int x0 = -19; x0 < 36; x0 += 5)
+        for (int y0 = -20; y0 < 36; y0 += 4)
+            for (int x1 = -21; x1 < 36; x1 += 3)
+                for (int y1 = -19; y1 < 36; y1 += 6)
+                {
+                    Pages a{};
+                    Pages b{};
+                    Gfx::line(a, x0, y0, x1, y1, 0xFF, Rop::Xor);
+                    lineSteps(b, x0, y0, x1, y1);
+                    if (a != b)
+                        return fail("Clipped line differs: " + std::to_string(x0) + "," + std::to_string(y0) +
+                                    " - " + std::to_string(x1) + "," + std::to_string(y1));
+                }
+    Gfx::line(pages, -1000000, -999990, 1000000, 1000010, 0xFF, Rop::Or);
+    if (count(pages) != 6 || !pixel(pages, 0, 10) || !pixel(pages, 5, 15))
+        return fail("Wrong long clipped line.");
+    pages = {};
+
+    // Midpoint circle, no duplicates on the octant boundaries
+    Gfx::circle(pages, 7, 7, 5, 0xFF, Rop::Xor);
+    const auto n = count(pages);
+    if (n != 28 || !pixel(pages, 12, 7) || !pixel(pages, 7, 2) || pixel(pages, 7, 7))
+        return fail("Wrong circle: " + std::to_string(n) + " pixels.");
+    Gfx::circle(pages, 7, 7, 5, 0xFF, Rop::Xor);
+    if (count(pages) != 0)
+        return fail("Circle pixels are drawn twice.");
+    Gfx::circle(pages, 0, 0, 3, 0xFF, Rop::Or);
+    if (count(pages) != 5)
+        return fail("Circle is not clipped.");
+
+    // 3x10 bitmap, shifted into two pages and clipped on the left
+    pages = {};
+    const uint8_t bmp[] = {0xFF, 0x01, 0x81, 0x03, 0xFF, 0x03};
+    r = Gfx::bitmap(pages, -1, 3, bmp, 3, 10, Rop::Copy);
+    if (r.x != 0 || r.w != 2 || r.y != 3 || r.h != 10)
+        return fail("Wrong bitmap bounds.");
+    if (count(pages) != 3 + 4 || !pixel(pages, 0, 3) || pixel(pages, 0, 10) || !pixel(pages, 0, 11) || !pixel(pages, 0, 12) ||
+        !pixel(pages, 1, 3) || !pixel(pages, 1, 10) || !pixel(pages, 1, 12) || pixel(pages, 1, 13))
+        return fail("Wrong bitmap blit.");
+
+    return 0;
+}
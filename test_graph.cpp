@@ -0,0 +1,62 @@
+#include "graph.h"
+
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+int fail(const std::string& message)
+{
+    std::cout << message << "\n";
+    return -1;
+}
+
+template <size_t W, size_t H>
+bool pixel(const Graph<W, H>& g, size_t x, size_t y)
+{
+    return (g.data()[y / 8 * W + x] >> (y % 8)) & 1;
+}
+
+int main()
+{
+    // Against brute force over a window, including runs of equal values
+    SlidingMinMax<int32_t, 5> mm;
+    std::vector<int32_t> all;
+    uint32_t seed = 1;
+    for (size_t i = 0; i < 200; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        const auto v = static_cast<int32_t>((seed >> 16) % 7) - 3;
+        mm.push(v);
+        all.push_back(v);
+        const auto first = all.end() - static_cast<std::ptrdiff_t>(std::min<size_t>(all.size(), 5));
+        if (mm.min() != *std::min_element(first, all.end()) || mm.max() != *std::max_element(first, all.end()))
+            return fail("Wrong min/max after " + std::to_string(i + 1) + " values.");
+    }
+    if (mm.size() != 5 || mm.at(0) != all.back() || mm.at(4) != all[all.size() - 5])
+        return fail("Wrong window.");
+
+    // Newest on the right, max on top, min at the bottom
+    Graph<4, 8> g;
+    g.push(10);
+    if (!pixel(g, 3, 4))
+        return fail("Flat line is not in the middle.");
+    g.push(20);
+    if (!pixel(g, 3, 0) || !pixel(g, 2, 7) || !pixel(g, 3, 7) || pixel(g, 1, 7))
+        return fail("Wrong scaled columns.");
+
+    // Same scale: the bitmap moves left, the new column connects to the previous sample
+    g.push(10);
+    g.push(20);
+    g.push(15);
+    if (!pixel(g, 0, 7) || !pixel(g, 1, 0) || !pixel(g, 3, 0) || !pixel(g, 3, 4) || pixel(g, 3, 5))
+        return fail("Wrong shifted columns.");
+
+    // Min leaves the window: rescaled
+    g.push(15);
+    g.push(20);
+    if (g.min() != 15 || g.max() != 20 || !pixel(g, 0, 0) || pixel(g, 0, 7) || !pixel(g, 2, 7) || !pixel(g, 3, 0))
+        return fail("Not rescaled.");
+
+    return 0;
+}
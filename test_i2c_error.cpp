@@ -0,0 +1,36 @@
+#include "i2cerror.h"
+
+#include <string>
+#include <iostream>
+
+using I2C::ErrorAction;
+using I2C::errorAction;
+
+int fail(const std::string& message)
+{
+    std::cout << message << "\n";
+    return -1;
+}
+
+int main()
+{
+    if (errorAction(I2C::SR1_ARLO) != ErrorAction::RETRY)
+        return fail("Lost arbitration recovers the bus.");
+
+    if (errorAction(I2C::SR1_AF) != ErrorAction::NACK)
+        return fail("NACK recovers the bus.");
+
+    if (errorAction(I2C::SR1_AF | I2C::SR1_ARLO) != ErrorAction::NACK)
+        return fail("NACK with lost arbitration isn't a NACK.");
+
+    if (errorAction(I2C::SR1_BERR) != ErrorAction::RECOVER)
+        return fail("Bus error doesn't recover the bus.");
+
+    if (errorAction(I2C::SR1_ARLO | I2C::SR1_BERR) != ErrorAction::RECOVER)
+        return fail("Bus error with lost arbitration doesn't recover the bus.");
+
+    if (errorAction(I2C::SR1_OVR) != ErrorAction::RECOVER)
+        return fail("Overrun doesn't recover the bus.");
+
+    return 0;
+}
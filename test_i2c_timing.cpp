@@ -0,0 +1,61 @@
+#include "clocks.h"
+#include "i2ctiming.h"
+
+using HPRE = Clocks::HPRE;
+using PPRE = Clocks::PPRE;
+
+void testStandard()
+{
+    using SysClock = Clocks::SysClock<Clocks::HSI<>, HPRE::DIV1, PPRE::DIV2, PPRE::DIV1>;
+    using Timing = I2C::TimingFor<SysClock, I2C::Standard<>>;
+
+    static_assert(Timing::value.freq == 8);
+    static_assert(Timing::value.trise == 9);
+    static_assert(Timing::value.ccr == 40);
+    static_assert(Timing::speed == 100000);
+}
+
+void testFast()
+{
+    using PLL = Clocks::PLL<Clocks::HSE<25.0>, 25, 336, 4, 7>;
+    using SysClock = Clocks::SysClock<PLL, HPRE::DIV2, PPRE::DIV2, PPRE::DIV1>;
+    using Timing = I2C::TimingFor<SysClock, I2C::Fast<>>;
+
+    static_assert(Timing::value.freq == 21);
+    static_assert(Timing::value.trise == 7);
+    static_assert(Timing::value.ccr == (0x8000 | 18));
+    static_assert(Timing::speed == 388888);
+    static_assert(Timing::lowNs >= 1300);
+    static_assert(Timing::highNs >= 600);
+}
+
+void testFastDuty16_9()
+{
+    using PLL = Clocks::PLL<Clocks::HSE<25.0>, 25, 336, 4, 7>;
+    using SysClock = Clocks::SysClock<PLL, HPRE::DIV1, PPRE::DIV2, PPRE::DIV1>;
+    using Timing = I2C::TimingFor<SysClock, I2C::FastDuty16_9<>>;
+
+    static_assert(Timing::value.freq == 42);
+    static_assert(Timing::value.trise == 13);
+    static_assert(Timing::value.ccr == (0xC000 | 5));
+    static_assert(Timing::speed == 336000);
+}
+
+void testSlowFast()
+{
+    using SysClock = Clocks::SysClock<Clocks::HSI<>, HPRE::DIV1, PPRE::DIV2, PPRE::DIV1>;
+    using Timing = I2C::TimingFor<SysClock, I2C::Fast<100000>>;
+
+    static_assert(Timing::value.freq == 8);
+    static_assert(Timing::value.trise == 3);
+    static_assert(Timing::value.ccr == (0x8000 | 27));
+}
+
+int main()
+{
+    testStandard();
+    testFast();
+    testFastDuty16_9();
+    testSlowFast();
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include "layer.h"
+
+#include <string>
+#include <iostream>
+
+int fail(const std::string& message)
+{
+    std::cout << message << "\n";
+    return -1;
+}
+
+using L = Layer<128, 32>;
+
+constexpr auto font = Font::font7x10();
+constexpr auto layer = L().text(3, 5, font, "Hi").vline(100, 1, 30).hline(110, 31, 20).pages();
+
+// Built at compile time
+static_assert(layer[0][100] == 0xFE && layer[3][100] == 0x7F, "Wrong vline");
+static_assert(layer[3][110] == 0x80 && layer[3][127] == 0x80, "Wrong hline");
+
+int main()
+{
+    // Same pixels as the glyphs printed at run time, pages straddled
+    L::Pages expected{};
+    size_t x = 3;
+    for (auto c : std::string_view("Hi"))
+    {
+        Glyph::blit(expected, x, 5, font.glyph(c), font.advance(c), font.height());
+        x += font.advance(c) + 1;
+    }
+    for (size_t page = 0; page < 4; ++page)
+        for (size_t col = 0; col < 100; ++col)
+            if (layer[page][col] != expected[page][col])
+                return fail("Text differs at page " + std::to_string(page) + ", column " + std::to_string(col) + ".");
+
+    return 0;
+}
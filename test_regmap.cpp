@@ -0,0 +1,98 @@
+#include "readings.h"
+
+#include <vector>
+#include <string>
+#include <iostream>
+
+int fail(const std::string& message)
+{
+    std::cout << message << "\n";
+    return -1;
+}
+
+// Controller side of the protocol: write the register number, repeated START, read
+template <typename Map>
+std::vector<uint8_t> readRegs(Map& map, uint8_t regNum, size_t size)
+{
+    map.onAddress(false);
+    map.onWrite(regNum);
+    map.onAddress(true);
+    std::vector<uint8_t> res;
+    for (size_t i = 0; i < size; ++i)
+        res.push_back(map.onRead());
+    map.onStop();
+    return res;
+}
+
+int main()
+{
+    static_assert(BE<uint16_t>{{0x12, 0x34}}.value() == 0x1234);
+    static_assert(LE<uint16_t>{{0x34, 0x12}}.value() == 0x1234);
+    static_assert(BE<int32_t>{{0xFF, 0xFF, 0xFF, 0xFE}}.value() == -2);
+
+    ReadingsMap map;
+
+    auto* r = map.beginUpdate();
+    if (r == nullptr)
+        return fail("Initial update is rejected.");
+    r->temperature = 2345;
+    r->busVoltage = 0xABCD;
+    r->status = Readings::BME280_VALID;
+    map.publish();
+
+    const auto id = readRegs(map, 0x00, 2);
+    if (id != std::vector<uint8_t>{'M', 1})
+        return fail("Wrong ID and version.");
+
+    const auto t = readRegs(map, 0x04, 4);
+    if (t != std::vector<uint8_t>{0x00, 0x00, 0x09, 0x29})
+        return fail("Temperature is not big-endian.");
+
+    const auto v = readRegs(map, 0x10, 2);
+    if (v != std::vector<uint8_t>{0xAB, 0xCD})
+        return fail("Wrong bus voltage.");
+
+    // Past the end
+    const auto tail = readRegs(map, sizeof(Readings) - 1, 3);
+    if (tail != std::vector<uint8_t>{0x00, 0xFF, 0xFF})
+        return fail("Bytes past the end must read as 0xFF.");
+
+    // Data written after the register number is ignored
+    map.onAddress(false);
+    map.onWrite(0x04);
+    map.onWrite(0x10);
+    map.onAddress(true);
+    if (map.onRead() != 0x00)
+        return fail("Register pointer is changed by a data byte.");
+    map.onStop();
+
+    // Update in the middle of a read doesn't tear the value
+    map.onAddress(false);
+    map.onWrite(0x04);
+    map.onAddress(true);
+    const auto b0 = map.onRead();
+    const auto b1 = map.onRead();
+    r = map.beginUpdate(); // Back buffer is free, the front one is latched
+    if (r == nullptr)
+        return fail("Update is rejected while the front buffer is read.");
+    r->temperature = -100;
+    map.publish();
+    if (map.beginUpdate() != nullptr)
+        return fail("Update of the latched buffer is allowed.");
+    const auto b2 = map.onRead();
+    const auto b3 = map.onRead();
+    map.onStop();
+    if (std::vector<uint8_t>{b0, b1, b2, b3} != std::vector<uint8_t>{0x00, 0x00, 0x09, 0x29})
+        return fail("Temperature is torn by an update.");
+
+    const auto t2 = readRegs(map, 0x04, 4);
+    if (t2 != std::vector<uint8_t>{0xFF, 0xFF, 0xFF, 0x9C})
+        return fail("New temperature is not published.");
+
+    // The back buffer starts as a copy of the front one
+    r = map.beginUpdate();
+    if (r == nullptr || r->busVoltage != 0xABCD || r->status != Readings::BME280_VALID)
+        return fail("Back buffer is not a copy of the front one.");
+
+    return 0;
+}
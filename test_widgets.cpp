@@ -0,0 +1,120 @@
+#include "widgets.h"
+#include "graph.h"
+
+#include <string>
+#include <iostream>
+#include <vector>
+
+int fail(const std::string& message)
+{
+    std::cout << message << "\n";
+    return -1;
+}
+
+// Records what the widgets draw
+struct FakeDisplay
+{
+    enum class Color { Black, White };
+
+    std::vector<std::string> texts;
+    std::vector<int> textX;
+    size_t bars = 0;
+    size_t bitmaps = 0;
+    size_t updates = 0;
+    bool scrolling = false;
+    uint8_t scrollFirst = 0;
+    uint8_t scrollLast = 0;
+
+    void bar(int, int, int, int, Color) { ++bars; }
+    void bitmap(int, int, const uint8_t*, int, int) { ++bitmaps; }
+    bool printAt(uint8_t x, uint8_t, const Font&, std::string_view text)
+    {
+        texts.emplace_back(text);
+        textX.push_back(x);
+        return true;
+    }
+    bool update() { ++updates; return true; }
+    bool startScroll(Panel::Scroll, uint8_t first, uint8_t last, Panel::ScrollSpeed)
+    {
+        scrolling = true;
+        scrollFirst = first;
+        scrollLast = last;
+        return true;
+    }
+    bool stopScroll() { scrolling = false; return true; }
+    void reset() { *this = {}; }
+};
+
+int main()
+{
+    FakeDisplay d;
+    constexpr auto font = Font::font6x8();
+
+    // Drawn once, then only when the text changes
+    Widget::Text<8> text({0, 0, 40, 8}, font, Widget::Align::Right, "ab");
+    if (!text.render(d) || d.texts != std::vector<std::string>{"ab"} || d.bars != 1)
+        return fail("Text not drawn.");
+    if (d.textX[0] != 40 - static_cast<int>(font.textWidth("ab")))
+        return fail("Text not right aligned.");
+    d.reset();
+    text.set("ab");
+    if (text.render(d) || !d.texts.empty() || d.bars != 0)
+        return fail("Unchanged text redrawn.");
+    text.set("abcdefghij");
+    if (!text.render(d) || text.view() != "abcdefgh" || d.textX[0] != 0)
+        return fail("Long text not truncated or not at the left edge.");
+    d.reset();
+    text.invalidate();
+    if (!text.render(d))
+        return fail("Invalidated text not redrawn.");
+
+    // Formatted on change only, fixed point with the sign and leading zeros
+    int32_t t = -5;
+    Widget::Number<int32_t> number({0, 0, 60, 8}, font, t, 1, "C", Widget::Align::Left);
+    d.reset();
+    if (!number.render(d) || d.texts != std::vector<std::string>{"-0.5", "C"})
+        return fail("Wrong negative number: " + (d.texts.empty() ? std::string() : d.texts[0]));
+    if (d.textX[1] != static_cast<int>(font.textWidth("-0.5") + 3))
+        return fail("Unit not after the number.");
+    d.reset();
+    if (number.render(d))
+        return fail("Unchanged number redrawn.");
+    t = 1234;
+    if (!number.render(d) || d.texts[0] != "123.4")
+        return fail("Wrong number: " + d.texts[0]);
+
+    uint32_t p = 750;
+    Widget::Number<uint32_t> plain({0, 0, 60, 8}, font, p);
+    d.reset();
+    if (!plain.render(d) || d.texts != std::vector<std::string>{"750"})
+        return fail("Wrong plain number.");
+
+    // Redrawn per sample and when bound to another graph
+    Graph<8, 8> a;
+    Graph<8, 8> b;
+    Widget::GraphView<Graph<8, 8>> view(0, 0, a);
+    d.reset();
+    if (!view.render(d) || view.render(d) || d.bitmaps != 1)
+        return fail("Graph not drawn once.");
+    a.push(1);
+    if (!view.render(d) || d.bitmaps != 2)
+        return fail("Graph not redrawn after a sample.");
+    view.bind(b);
+    if (!view.render(d) || d.bitmaps != 3)
+        return fail("Graph not redrawn after bind.");
+
+    // Sent once, then the controller scrolls its pages
+    Widget::Ticker ticker(3, 3, 128, font, "Alarm");
+    d.reset();
+    if (!ticker.render(d) || ticker.render(d) || d.updates != 1 || d.texts.size() != 1)
+        return fail("Ticker not drawn once.");
+    if (!d.scrolling || !ticker.isRunning() || d.scrollFirst != 3 || d.scrollLast != 3)
+        return fail("Ticker not scrolling page 3.");
+    ticker.stop(d);
+    if (d.scrolling || ticker.isRunning())
+        return fail("Ticker not stopped.");
+    if (!ticker.render(d) || !d.scrolling)
+        return fail("Ticker not restarted.");
+
+    return 0;
+}
@@ -0,0 +1,270 @@
+#pragma once
+
+#include "gfx.h"
+#include "fonts.h"
+#include "panel.h" // Panel::Scroll
+
+#include <array>
+#include <charconv>    // std::to_chars
+#include <string_view>
+#include <algorithm>   // std::max, std::copy_n
+#include <cstdint>
+#include <cstddef>     // size_t
+
+/*
+ * Retained-mode widgets. A widget knows its box and what it shows, render()
+ * draws it only if that changed and returns whether it did. The box is
+ * cleared and redrawn, so only the box ends up dirty in the display.
+ * invalidate() forces the next render(), e.g. after the screen was cleared.
+ *
+ * D is BasicDisplay everywhere.
+ */
+
+namespace Widget
+{
+
+enum class Align : uint8_t { Left, Center, Right };
+
+// x of text of width w in the box, text wider than the box starts at its left edge
+inline
+int alignedX(const Gfx::Rect& box, size_t w, Align align)
+{
+    const auto space = box.w - static_cast<int>(w);
+    switch (align)
+    {
+        case Align::Left:   return box.x;
+        case Align::Center: return box.x + std::max(space / 2, 0);
+        case Align::Right:  return box.x + std::max(space, 0);
+    };
+    return box.x;
+}
+
+class Base
+{
+    public:
+        explicit Base(const Gfx::Rect& box) : m_box(box) {}
+
+        const Gfx::Rect& box() const { return m_box; }
+        void invalidate() { m_dirty = true; }
+
+    protected:
+        Gfx::Rect m_box;
+        bool m_dirty = true;
+
+        template <typename D>
+        void clear(D& d) const { d.bar(m_box.x, m_box.y, m_box.w, m_box.h, D::Color::Black); }
+};
+
+// Up to N characters, set() with the same text changes nothing
+template <size_t N>
+class Text : public Base
+{
+    public:
+        Text(const Gfx::Rect& box, const Font& font, Align align = Align::Left, std::string_view text = {})
+            : Base(box),
+              m_font(font),
+              m_align(align)
+        {
+            set(text);
+        }
+
+        void set(std::string_view text)
+        {
+            text = text.substr(0, N);
+            if (text == view())
+                return;
+            std::copy_n(text.begin(), text.size(), m_text.begin());
+            m_size = text.size();
+            m_dirty = true;
+        }
+        std::string_view view() const { return {m_text.data(), m_size}; }
+
+        template <typename D>
+        bool render(D& d)
+        {
+            if (!m_dirty)
+                return false;
+            clear(d);
+            const auto x = alignedX(m_box, m_font.textWidth(view()), m_align);
+            d.printAt(static_cast<uint8_t>(x), static_cast<uint8_t>(m_box.y), m_font, view());
+            m_dirty = false;
+            return true;
+        }
+
+    private:
+        const Font& m_font;
+        Align m_align;
+        std::array<char, N> m_text{};
+        size_t m_size = 0;
+};
+
+/*
+ * A number bound by reference, formatted only when it changes.
+ * decimals - fixed point digits of the value, 1 shows 234 as 23.4;
+ * unit     - follows the number, space pixels apart.
+ */
+template <typename T>
+class Number : public Base
+{
+    public:
+        Number(const Gfx::Rect& box, const Font& font, const T& value, uint8_t decimals = 0,
+               std::string_view unit = {}, Align align = Align::Right, size_t space = 3)
+            : Base(box),
+              m_font(font),
+              m_value(value),
+              m_shown(value),
+              m_decimals(decimals),
+              m_unit(unit),
+              m_align(align),
+              m_space(space)
+        {
+        }
+
+        template <typename D>
+        bool render(D& d)
+        {
+            if (!m_dirty && m_shown == m_value)
+                return false;
+            m_shown = m_value;
+            std::array<char, 16> buf;
+            const auto text = format(buf);
+            const auto w = m_font.textWidth(text);
+            const auto unitW = m_unit.empty() ? 0 : m_space + m_font.textWidth(m_unit);
+            const auto x = alignedX(m_box, w + unitW, m_align);
+            const auto y = static_cast<uint8_t>(m_box.y);
+            clear(d);
+            d.printAt(static_cast<uint8_t>(x), y, m_font, text);
+            if (!m_unit.empty())
+                d.printAt(static_cast<uint8_t>(x + static_cast<int>(w + m_space)), y, m_font, m_unit);
+            m_dirty = false;
+            return true;
+        }
+
+    private:
+        const Font& m_font;
+        const T& m_value;
+        T m_shown;
+        uint8_t m_decimals;
+        std::string_view m_unit;
+        Align m_align;
+        size_t m_space;
+
+        std::string_view format(std::array<char, 16>& buf) const
+        {
+            auto* p = buf.data();
+            auto* end = buf.data() + buf.size();
+            auto v = static_cast<int64_t>(m_shown);
+            if (v < 0)
+            {
+                *p++ = '-';
+                v = -v;
+            }
+            int64_t scale = 1;
+            for (size_t i = 0; i < m_decimals; ++i)
+                scale *= 10;
+            p = std::to_chars(p, end, v / scale).ptr;
+            if (m_decimals > 0)
+            {
+                *p++ = '.';
+                const auto frac = v % scale;
+                for (auto s = scale / 10; s > 0; s /= 10) // Leading zeros
+                    *p++ = static_cast<char>('0' + frac / s % 10);
+            }
+            return {buf.data(), static_cast<size_t>(p - buf.data())};
+        }
+};
+
+// Graph with W x H of the box, redrawn when a sample is pushed or it's bound to another graph
+template <typename G>
+class GraphView : public Base
+{
+    public:
+        GraphView(int x, int y, const G& graph)
+            : Base({x, y, static_cast<int>(G::width), static_cast<int>(G::height)}),
+              m_graph(&graph)
+        {
+        }
+
+        void bind(const G& graph)
+        {
+            if (&graph == m_graph)
+                return;
+            m_graph = &graph;
+            m_dirty = true;
+        }
+
+        template <typename D>
+        bool render(D& d)
+        {
+            if (!m_dirty && m_shown == m_graph->version())
+                return false;
+            m_shown = m_graph->version();
+            m_graph->draw(d, m_box.x, m_box.y); // Covers the whole box
+            m_dirty = false;
+            return true;
+        }
+
+    private:
+        const G* m_graph;
+        uint32_t m_shown = 0;
+};
+
+/*
+ * Text on whole pages scrolled by the controller: render() draws and sends
+ * it once and starts the scroll, then there is no CPU or bus cost till
+ * stop(). The pages rotate, so the text is at most the panel wide.
+ * The text must outlive the ticker.
+ */
+class Ticker : public Base
+{
+    public:
+        Ticker(uint8_t firstPage, uint8_t lastPage, int width, const Font& font, std::string_view text,
+               Panel::ScrollSpeed speed = Panel::ScrollSpeed::Frames5, Panel::Scroll dir = Panel::Scroll::Left)
+            : Base({0, firstPage * 8, width, (lastPage - firstPage + 1) * 8}),
+              m_font(font),
+              m_text(text),
+              m_speed(speed),
+              m_dir(dir)
+        {
+        }
+
+        bool isRunning() const { return m_running; }
+
+        template <typename D>
+        bool render(D& d)
+        {
+            if (!m_dirty)
+                return false;
+            clear(d);
+            const auto x = alignedX(m_box, m_font.textWidth(m_text), Align::Center);
+            const auto y = m_box.y + (m_box.h - static_cast<int>(m_font.height())) / 2;
+            d.printAt(static_cast<uint8_t>(x), static_cast<uint8_t>(y), m_font, m_text);
+            d.update();
+            m_running = d.startScroll(m_dir, firstPage(), lastPage(), m_speed);
+            m_dirty = false;
+            return true;
+        }
+
+        // The next update() of the display rewrites the whole frame
+        template <typename D>
+        void stop(D& d)
+        {
+            if (!m_running)
+                return;
+            d.stopScroll();
+            m_running = false;
+            m_dirty = true;
+        }
+
+    private:
+        const Font& m_font;
+        std::string_view m_text;
+        Panel::ScrollSpeed m_speed;
+        Panel::Scroll m_dir;
+        bool m_running = false;
+
+        uint8_t firstPage() const { return static_cast<uint8_t>(m_box.y / 8); }
+        uint8_t lastPage() const { return static_cast<uint8_t>((m_box.y + m_box.h) / 8 - 1); }
+};
+
+}